@@ -0,0 +1,30 @@
+# Writes the SPIR-V binary INPUT to the header OUTPUT as `constexpr uint32_t SYMBOL[]`.
+# Usage: cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DSYMBOL=<name> -P EmbedSpirv.cmake
+
+file(READ "${INPUT}" bytes HEX)
+string(LENGTH "${bytes}" length)
+math(EXPR remainder "${length} % 8")
+if(length EQUAL 0 OR NOT remainder EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a SPIR-V binary")
+endif()
+
+# SPIR-V is a stream of little-endian 32-bit words.
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u," words "${bytes}")
+# Eight words per line; CMake regular expressions have no {n} quantifier.
+set(line "")
+foreach(i RANGE 7)
+    string(APPEND line "0x[0-9a-f]+u,")
+endforeach()
+string(REGEX REPLACE "(${line})" "\\1\n        " words "${words}")
+string(REGEX REPLACE "\n        $" "" words "${words}")
+
+string(TOUPPER "${SYMBOL}_H" guard)
+file(WRITE "${OUTPUT}"
+    "// Generated from ${INPUT} by EmbedSpirv.cmake, do not edit.\n"
+    "#include <cstdint>\n\n"
+    "#ifndef ${guard}\n"
+    "#define ${guard}\n"
+    "    constexpr uint32_t ${SYMBOL}[] = {\n"
+    "        ${words}\n"
+    "    };\n"
+    "#endif\n")
@@ -0,0 +1,61 @@
+# Compiles GLSL shaders to SPIR-V at build time and embeds the words in headers, see EmbedSpirv.cmake.
+#
+# add_embedded_shaders(<target> <shader>...) compiles every shader into ${CMAKE_BINARY_DIR}/shaders/<name>.spv and
+# <name>.h, e.g. shader.vert becomes shader.vert.h declaring `constexpr uint32_t shader_vert[]`, and makes the
+# headers available to <target>. Shaders are rebuilt when they or any file they #include change.
+
+if(DEFINED Vulkan_GLSLANG_VALIDATOR_EXECUTABLE AND Vulkan_GLSLANG_VALIDATOR_EXECUTABLE)
+    set(GLSLANG_VALIDATOR "${Vulkan_GLSLANG_VALIDATOR_EXECUTABLE}")
+else()
+    find_program(GLSLANG_VALIDATOR NAMES glslangValidator HINTS "$ENV{VULKAN_SDK}/bin" "$ENV{VULKAN_SDK}/Bin")
+endif()
+if(NOT GLSLANG_VALIDATOR)
+    message(FATAL_ERROR "glslangValidator not found; install the Vulkan SDK or set GLSLANG_VALIDATOR")
+endif()
+
+# DEPFILE is only understood by Ninja before CMake 3.21.
+if(CMAKE_VERSION VERSION_GREATER_EQUAL 3.21 OR CMAKE_GENERATOR MATCHES "Ninja")
+    set(SHADER_DEPFILES ON)
+else()
+    set(SHADER_DEPFILES OFF)
+endif()
+
+function(add_embedded_shaders target)
+    set(output_dir "${CMAKE_BINARY_DIR}/shaders")
+    file(MAKE_DIRECTORY "${output_dir}")
+
+    set(headers)
+    foreach(shader ${ARGN})
+        get_filename_component(name "${shader}" NAME)
+        string(MAKE_C_IDENTIFIER "${name}" symbol)
+        set(spirv "${output_dir}/${name}.spv")
+        set(header "${output_dir}/${name}.h")
+        set(depfile "${output_dir}/${name}.d")
+
+        set(depfile_args)
+        set(depfile_option)
+        if(SHADER_DEPFILES)
+            set(depfile_args DEPFILE "${depfile}")
+            set(depfile_option --depfile "${depfile}")
+        endif()
+
+        add_custom_command(
+            OUTPUT "${spirv}" "${header}"
+            COMMAND "${GLSLANG_VALIDATOR}" -V "${shader}" -o "${spirv}" ${depfile_option}
+            COMMAND "${CMAKE_COMMAND}" -DINPUT=${spirv} -DOUTPUT=${header} -DSYMBOL=${symbol}
+                    -P "${CMAKE_SOURCE_DIR}/cmake/EmbedSpirv.cmake"
+            DEPENDS "${shader}" "${CMAKE_SOURCE_DIR}/cmake/EmbedSpirv.cmake"
+            ${depfile_args}
+            COMMENT "Compiling shader ${name}"
+            VERBATIM)
+        list(APPEND headers "${header}")
+    endforeach()
+
+    add_custom_target(${target}_shaders DEPENDS ${headers})
+    add_dependencies(${target} ${target}_shaders)
+    target_include_directories(${target} PRIVATE "${output_dir}")
+    # Lets shader hot reloading find the sources and compile them the same way.
+    target_compile_definitions(${target} PRIVATE
+        SHADER_SOURCE_DIR="${CMAKE_CURRENT_SOURCE_DIR}/pipeline/shaders"
+        GLSLANG_VALIDATOR_PATH="${GLSLANG_VALIDATOR}")
+endfunction()
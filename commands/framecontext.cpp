@@ -0,0 +1,157 @@
+#include <vector>
+
+#ifndef FRAME_CONTEXT
+#define FRAME_CONTEXT
+    struct CommandBufferCounters {
+        uint32_t allocated = 0;
+        uint32_t reused = 0;
+    };
+
+    // A TRANSIENT command pool whose buffers are never freed or reset one by one. allocate() hands out a buffer left
+    // over from an earlier frame when there is one and only allocates when the pool runs dry; reset() recycles all of
+    // them at once with vkResetCommandPool.
+    class TransientCommandPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> primaries;
+        std::vector<VkCommandBuffer> secondaries;
+        size_t usedPrimaries = 0;
+        size_t usedSecondaries = 0;
+        CommandBufferCounters counters;
+
+    public:
+        void init(VkDevice& device, uint32_t queueFamilyIndex) {
+            VkCommandPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.queueFamilyIndex = queueFamilyIndex;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+            if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create transient command pool!");
+            }
+        }
+
+        VkCommandBuffer allocate(VkDevice& device, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY) {
+            bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            std::vector<VkCommandBuffer>& buffers = primary ? primaries : secondaries;
+            size_t& used = primary ? usedPrimaries : usedSecondaries;
+
+            if (used < buffers.size()) {
+                counters.reused++;
+                return buffers[used++];
+            }
+
+            VkCommandBufferAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = pool;
+            allocInfo.level = level;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer commandBuffer;
+            if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate command buffer!");
+            }
+            buffers.push_back(commandBuffer);
+            used++;
+            counters.allocated++;
+            return commandBuffer;
+        }
+
+        // Only valid once every submission using the pool's buffers has completed.
+        void reset(VkDevice& device) {
+            if (vkResetCommandPool(device, pool, 0) != VK_SUCCESS) {
+                throw std::runtime_error("failed to reset command pool!");
+            }
+            usedPrimaries = 0;
+            usedSecondaries = 0;
+            counters = CommandBufferCounters();
+        }
+
+        // Counts since the last reset().
+        CommandBufferCounters getCounters() {
+            return counters;
+        }
+
+        void cleanup(VkDevice& device) {
+            vkDestroyCommandPool(device, pool, nullptr);
+            primaries.clear();
+            secondaries.clear();
+        }
+    };
+
+    // Command recording state of one frame in flight: a pool for the render thread's graphics command buffers, one each
+    // for its transfer and compute command buffers and one per parallel recording task. Everything is recycled by
+    // begin() after the frame's fence has signaled. When transfer or compute share the graphics family their pools are
+    // still separate, which keeps begin() independent of the queue layout.
+    class FrameContext {
+        TransientCommandPool graphicsPool;
+        TransientCommandPool transferPool;
+        TransientCommandPool computePool;
+        std::vector<TransientCommandPool> taskPools;
+
+    public:
+        void init(VkDevice& device, uint32_t graphicsFamily, uint32_t transferFamily, uint32_t computeFamily, size_t taskCount) {
+            graphicsPool.init(device, graphicsFamily);
+            transferPool.init(device, transferFamily);
+            computePool.init(device, computeFamily);
+            taskPools.resize(taskCount);
+            for (auto& pool : taskPools) {
+                pool.init(device, graphicsFamily);
+            }
+        }
+
+        void begin(VkDevice& device) {
+            graphicsPool.reset(device);
+            transferPool.reset(device);
+            computePool.reset(device);
+            for (auto& pool : taskPools) {
+                pool.reset(device);
+            }
+        }
+
+        TransientCommandPool& getGraphicsPool() {
+            return graphicsPool;
+        }
+
+        TransientCommandPool& getTransferPool() {
+            return transferPool;
+        }
+
+        TransientCommandPool& getComputePool() {
+            return computePool;
+        }
+
+        TransientCommandPool& getTaskPool(size_t task) {
+            return taskPools[task];
+        }
+
+        size_t getTaskCount() {
+            return taskPools.size();
+        }
+
+        CommandBufferCounters getCounters() {
+            CommandBufferCounters total = graphicsPool.getCounters();
+            add(total, transferPool.getCounters());
+            add(total, computePool.getCounters());
+            for (auto& pool : taskPools) {
+                add(total, pool.getCounters());
+            }
+            return total;
+        }
+
+        void cleanup(VkDevice& device) {
+            graphicsPool.cleanup(device);
+            transferPool.cleanup(device);
+            computePool.cleanup(device);
+            for (auto& pool : taskPools) {
+                pool.cleanup(device);
+            }
+            taskPools.clear();
+        }
+
+    private:
+        static void add(CommandBufferCounters& total, CommandBufferCounters counters) {
+            total.allocated += counters.allocated;
+            total.reused += counters.reused;
+        }
+    };
+#endif
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <vector>
+#include "threadpool.cpp"
+#include "framecontext.cpp"
+
+#ifndef PARALLEL_RECORDER
+#define PARALLEL_RECORDER
+    // Splits a frame's draws into contiguous ranges recorded in parallel into secondary command buffers. Every task
+    // records from its own pool of the frame's FrameContext, so no pool is ever used by two threads at once. The
+    // returned buffers are executed by the primary in task order, which keeps the draw order identical to
+    // single-threaded recording.
+    class ParallelRecorder {
+        ThreadPool workers;
+        uint32_t minDrawsPerTask = 0;
+
+    public:
+        using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)>;
+
+        // The calling thread records the first range itself, so threadCount - 1 workers are started. Frame contexts
+        // need getThreadCount() task pools.
+        void init(size_t threadCount, uint32_t minDrawsPerTaskCount = 256) {
+            std::cout << "Initializing parallel recorder (" << threadCount << " threads)..." << std::endl;
+            minDrawsPerTask = minDrawsPerTaskCount;
+            workers.init(threadCount - 1);
+        }
+
+        // Records drawCount draws for the render pass and framebuffer in inheritance. recordDraws is called
+        // concurrently from several threads and must only record into the command buffer it is given.
+        std::vector<VkCommandBuffer> record(VkDevice& device, FrameContext& frame, const VkCommandBufferInheritanceInfo& inheritance,
+                                            uint32_t drawCount, const RecordFunction& recordDraws) {
+            uint32_t taskCount = (drawCount + minDrawsPerTask - 1) / minDrawsPerTask;
+            taskCount = std::max(1u, std::min(taskCount, static_cast<uint32_t>(frame.getTaskCount())));
+
+            std::vector<VkCommandBuffer> commandBuffers;
+            std::vector<std::future<void>> pending;
+            uint32_t firstDraw = 0;
+            uint32_t firstCount = 0;
+            for (uint32_t i = 0; i < taskCount; i++) {
+                uint32_t count = drawCount / taskCount + (i < drawCount % taskCount ? 1 : 0);
+                // Allocated here rather than on the worker, which keeps each pool on a single thread at a time.
+                VkCommandBuffer commandBuffer = frame.getTaskPool(i).allocate(device, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+                commandBuffers.push_back(commandBuffer);
+                if (i == 0) {
+                    firstCount = count;
+                } else {
+                    pending.push_back(workers.submit([=, &inheritance, &recordDraws] {
+                        recordRange(commandBuffer, inheritance, firstDraw, count, recordDraws);
+                    }));
+                }
+                firstDraw += count;
+            }
+
+            // The workers reference inheritance and recordDraws, so they are always waited for before returning.
+            std::exception_ptr error;
+            try {
+                recordRange(commandBuffers[0], inheritance, 0, firstCount, recordDraws);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            for (auto& task : pending) {
+                task.wait();
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            for (auto& task : pending) {
+                task.get();
+            }
+            return commandBuffers;
+        }
+
+        size_t getThreadCount() {
+            return workers.getSize() + 1;
+        }
+
+        void cleanup() {
+            workers.cleanup();
+        }
+
+    private:
+        static void recordRange(VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritance,
+                                uint32_t firstDraw, uint32_t drawCount, const RecordFunction& recordDraws) {
+            VkCommandBufferBeginInfo beginInfo = {};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &inheritance;
+
+            if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+                throw std::runtime_error("failed to begin recording secondary command buffer!");
+            }
+
+            recordDraws(commandBuffer, firstDraw, drawCount);
+
+            if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to record secondary command buffer!");
+            }
+        }
+    };
+#endif
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+#include "threadpool.cpp"
+#include "frustum.cpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CPU_CULLER_SSE
+#endif
+
+#ifndef CPU_CULLER
+#define CPU_CULLER
+    // Bounding spheres in structure-of-arrays layout, so four consecutive objects load into one SSE register per
+    // component. The arrays are padded to a multiple of four with spheres of negative infinite radius, which never
+    // intersect anything, so the culling loop needs no tail handling.
+    class SphereBounds {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> radius;
+        uint32_t count = 0;
+
+    public:
+        void resize(uint32_t objectCount) {
+            count = objectCount;
+            size_t padded = (static_cast<size_t>(objectCount) + 3) & ~static_cast<size_t>(3);
+            x.assign(padded, 0.0f);
+            y.assign(padded, 0.0f);
+            z.assign(padded, 0.0f);
+            radius.assign(padded, -std::numeric_limits<float>::infinity());
+        }
+
+        void set(uint32_t object, const glm::vec3& center, float sphereRadius) {
+            x[object] = center.x;
+            y[object] = center.y;
+            z[object] = center.z;
+            radius[object] = sphereRadius;
+        }
+
+        uint32_t getCount() const {
+            return count;
+        }
+
+        // End of the padded range; cullRange() may be given any end up to this.
+        uint32_t getPaddedCount() const {
+            return static_cast<uint32_t>(radius.size());
+        }
+
+        // Culls the objects [begin, end), where begin is a multiple of four, and writes the indices of the visible
+        // ones to visible in ascending order. Returns how many were written.
+        uint32_t cullRange(const Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* visible) const {
+#ifdef CPU_CULLER_SSE
+            uint32_t visibleCount = 0;
+            __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+            for (int plane = 0; plane < 6; plane++) {
+                planeX[plane] = _mm_set1_ps(frustum.planes[plane].x);
+                planeY[plane] = _mm_set1_ps(frustum.planes[plane].y);
+                planeZ[plane] = _mm_set1_ps(frustum.planes[plane].z);
+                planeW[plane] = _mm_set1_ps(frustum.planes[plane].w);
+            }
+            const __m128 signBit = _mm_set1_ps(-0.0f);
+
+            for (uint32_t object = begin; object < end; object += 4) {
+                __m128 centerX = _mm_loadu_ps(&x[object]);
+                __m128 centerY = _mm_loadu_ps(&y[object]);
+                __m128 centerZ = _mm_loadu_ps(&z[object]);
+                __m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(&radius[object]), signBit);
+
+                __m128 inside = _mm_cmpeq_ps(centerX, centerX);
+                for (int plane = 0; plane < 6; plane++) {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[plane], centerX), _mm_mul_ps(planeY[plane], centerY)),
+                                                 _mm_add_ps(_mm_mul_ps(planeZ[plane], centerZ), planeW[plane]));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+                }
+
+                int mask = _mm_movemask_ps(inside);
+                for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1) {
+                    visible[visibleCount] = object + lane;
+                    visibleCount += mask & 1;
+                }
+            }
+            return visibleCount;
+#else
+            return cullRangeScalar(frustum, begin, end, visible);
+#endif
+        }
+
+        // cullRange() one object at a time; the fallback without SSE and the baseline it is benchmarked against.
+        uint32_t cullRangeScalar(const Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* visible) const {
+            uint32_t visibleCount = 0;
+            for (uint32_t object = begin; object < end; object++) {
+                visible[visibleCount] = object;
+                visibleCount += frustum.intersectsSphere(glm::vec3(x[object], y[object], z[object]), radius[object]) ? 1 : 0;
+            }
+            return visibleCount;
+        }
+    };
+
+    // Culls SphereBounds against a frustum on several threads. The objects are split into contiguous ranges, each
+    // written to its own output buffer, and the results are concatenated in range order, so the visible list is in
+    // ascending object order no matter how many threads took part.
+    class CpuCuller {
+        ThreadPool workers;
+        uint32_t minObjectsPerTask = 0;
+        std::vector<std::vector<uint32_t>> taskVisible;
+        std::vector<uint32_t> taskCounts;
+
+    public:
+        // The calling thread culls the first range itself, so threadCount - 1 workers are started.
+        void init(size_t threadCount, uint32_t minObjectsPerTaskCount = 16384) {
+            std::cout << "Initializing CPU culler (" << threadCount << " threads)..." << std::endl;
+            minObjectsPerTask = minObjectsPerTaskCount;
+            workers.init(threadCount - 1);
+            taskVisible.resize(threadCount);
+            taskCounts.resize(threadCount);
+        }
+
+        void cull(const SphereBounds& bounds, const Frustum& frustum, std::vector<uint32_t>& visible) {
+            uint32_t groups = bounds.getPaddedCount() / 4;
+            uint32_t taskCount = (bounds.getCount() + minObjectsPerTask - 1) / minObjectsPerTask;
+            taskCount = std::max(1u, std::min({taskCount, groups, static_cast<uint32_t>(taskVisible.size())}));
+
+            std::vector<std::future<void>> pending;
+            uint32_t begin = 0;
+            uint32_t firstEnd = 0;
+            for (uint32_t i = 0; i < taskCount; i++) {
+                // Ranges are split on groups of four, which keeps every range start aligned for cullRange().
+                uint32_t end = begin + (groups / taskCount + (i < groups % taskCount ? 1 : 0)) * 4;
+                // Sized here rather than on the worker; only grows, so steady state does not allocate.
+                if (taskVisible[i].size() < end - begin) {
+                    taskVisible[i].resize(end - begin);
+                }
+                if (i == 0) {
+                    firstEnd = end;
+                } else {
+                    pending.push_back(workers.submit([this, &bounds, &frustum, i, begin, end] {
+                        taskCounts[i] = bounds.cullRange(frustum, begin, end, taskVisible[i].data());
+                    }));
+                }
+                begin = end;
+            }
+
+            taskCounts[0] = bounds.cullRange(frustum, 0, firstEnd, taskVisible[0].data());
+            for (auto& task : pending) {
+                task.get();
+            }
+
+            visible.clear();
+            for (uint32_t i = 0; i < taskCount; i++) {
+                visible.insert(visible.end(), taskVisible[i].begin(), taskVisible[i].begin() + taskCounts[i]);
+            }
+        }
+
+        size_t getThreadCount() {
+            return workers.getSize() + 1;
+        }
+
+        void cleanup() {
+            workers.cleanup();
+        }
+    };
+#endif
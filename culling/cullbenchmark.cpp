@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+#include "cpuculler.cpp"
+#include "benchmark.cpp"
+
+#ifndef CULL_BENCHMARK
+#define CULL_BENCHMARK
+    // Frustum culling on its own, without a device: culls objectCount random spheres iterations times with the scalar
+    // loop, the SSE loop on one thread and the CpuCuller on threadCount threads, and reports the time per pass and
+    // objects per second of each. The spheres are spread over twice the clip volume in x and y and over [-0.5, 1.5]
+    // in z, so most of them fall outside the frustum and the visible list is sparse, like in a large scene.
+    FrameBenchmark runCullBenchmark(uint32_t objectCount, uint32_t iterations, size_t threadCount) {
+        std::cout << "Benchmarking culling of " << objectCount << " objects, " << iterations << " passes..." << std::endl;
+        SphereBounds bounds;
+        bounds.resize(objectCount);
+        // Fixed seed, so runs cull the same scene.
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> lateral(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> depth(-0.5f, 1.5f);
+        std::uniform_real_distribution<float> radius(0.01f, 0.05f);
+        for (uint32_t object = 0; object < objectCount; object++) {
+            bounds.set(object, glm::vec3(lateral(random), lateral(random), depth(random)), radius(random));
+        }
+        // The clip volume, as for the instances drawn by the application.
+        Frustum frustum = Frustum::fromMatrix(glm::mat4(1.0f));
+
+        CpuCuller culler;
+        culler.init(threadCount);
+        std::vector<uint32_t> scalarVisible(bounds.getPaddedCount());
+        std::vector<uint32_t> simdVisible(bounds.getPaddedCount());
+        std::vector<uint32_t> threadedVisible;
+        uint32_t scalarCount = 0;
+        uint32_t simdCount = 0;
+
+        FrameBenchmark benchmark;
+        benchmark.enable();
+        Stopwatch timer;
+        for (uint32_t i = 0; i < iterations; i++) {
+            timer.lap();
+            scalarCount = bounds.cullRangeScalar(frustum, 0, bounds.getPaddedCount(), scalarVisible.data());
+            benchmark.record("cull_ms", "scalar", timer.lap());
+            simdCount = bounds.cullRange(frustum, 0, bounds.getPaddedCount(), simdVisible.data());
+            benchmark.record("cull_ms", "simd", timer.lap());
+            culler.cull(bounds, frustum, threadedVisible);
+            benchmark.record("cull_ms", "simd_threaded", timer.lap());
+        }
+        size_t threads = culler.getThreadCount();
+        culler.cleanup();
+
+        // The SSE loop adds the plane terms in a different order, so a sphere touching a plane may land differently.
+        scalarVisible.resize(scalarCount);
+        simdVisible.resize(simdCount);
+        std::vector<uint32_t> mismatched;
+        std::set_symmetric_difference(scalarVisible.begin(), scalarVisible.end(), simdVisible.begin(), simdVisible.end(),
+                                      std::back_inserter(mismatched));
+
+        auto objectsPerSecond = [&](const std::string& name) {
+            double total = benchmark.sum("cull_ms", name);
+            return total > 0.0 ? static_cast<double>(objectCount) * iterations / (total / 1000.0) : 0.0;
+        };
+        auto speedup = [&](const std::string& name) {
+            double total = benchmark.sum("cull_ms", name);
+            return total > 0.0 ? benchmark.sum("cull_ms", "scalar") / total : 0.0;
+        };
+#ifdef CPU_CULLER_SSE
+        benchmark.setInfo("simd", "sse");
+#else
+        benchmark.setInfo("simd", "none");
+#endif
+        benchmark.setInfo("mode", "cull_bench");
+        benchmark.setMetric("cull.objects", objectCount);
+        benchmark.setMetric("cull.iterations", iterations);
+        benchmark.setMetric("cull.threads", threads);
+        benchmark.setMetric("cull.visible_fraction", objectCount > 0 ? static_cast<double>(simdCount) / objectCount : 0.0);
+        benchmark.setMetric("cull.mismatched_objects", static_cast<double>(mismatched.size()));
+        benchmark.setMetric("cull.scalar.objects_per_second", objectsPerSecond("scalar"));
+        benchmark.setMetric("cull.simd.objects_per_second", objectsPerSecond("simd"));
+        benchmark.setMetric("cull.simd_threaded.objects_per_second", objectsPerSecond("simd_threaded"));
+        benchmark.setMetric("cull.simd.speedup", speedup("simd"));
+        benchmark.setMetric("cull.simd_threaded.speedup", speedup("simd_threaded"));
+        return benchmark;
+    }
+#endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include <array>
+#include <glm/glm.hpp>
+
+#ifndef FRUSTUM
+#define FRUSTUM
+    // The six planes of a view frustum in world space, with normals pointing inwards: a point p is inside a plane
+    // when dot(plane.xyz, p) + plane.w >= 0. Planes are normalized, so that value is a signed distance.
+    struct Frustum {
+        std::array<glm::vec4, 6> planes;
+
+        // Extracts the planes from a view-projection matrix (Gribb & Hartmann) using Vulkan's 0..1 clip depth.
+        static Frustum fromMatrix(const glm::mat4& viewProjection) {
+            glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+            glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+            glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+            glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+            Frustum frustum;
+            frustum.planes = {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2};
+            for (glm::vec4& plane : frustum.planes) {
+                plane /= glm::length(glm::vec3(plane));
+            }
+            return frustum;
+        }
+
+        bool intersectsSphere(const glm::vec3& center, float radius) const {
+            for (const glm::vec4& plane : planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+#endif
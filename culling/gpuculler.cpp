@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <vector>
+#include "deviceallocator.cpp"
+#include "graphicspipeline.cpp"
+#include "frustum.cpp"
+
+#ifndef GPU_CULLER
+#define GPU_CULLER
+    // Matches the push constant block of cull.comp.
+    struct CullPushConstants {
+        std::array<glm::vec4, 6> planes;
+        uint32_t objectCount;
+        uint32_t indexCount;
+        float boundingRadius;
+    };
+
+    // Frustum culls the objects of an instance buffer in a compute pass and writes one compacted
+    // VkDrawIndexedIndirectCommand per visible object (instanceCount 1, firstInstance the object) plus the number
+    // written, so the frame draws whatever survived without any per-object CPU work. Every frame in flight has its
+    // own command and count buffers, so a frame's dispatch never overwrites draws an earlier frame still reads.
+    //
+    // Without drawIndirectCount the whole command buffer is zeroed before the dispatch and drawn with
+    // vkCmdDrawIndexedIndirect at full capacity; the entries past the count then draw nothing. Those draws are split
+    // into calls of at most maxDrawIndirectCount commands (one without multiDrawIndirect). Since the count written by
+    // the GPU cannot be split, a capacity above that limit also falls back to these draws.
+    //
+    // The dispatch may run on a dedicated compute queue family. record() then releases the objects and the draws to
+    // the drawing family and recordAcquire() takes them over there. Every frame the host rewrites the objects and the
+    // dispatch clears the draws before writing them, so nothing has to be transferred back to the compute family.
+    class GpuCuller {
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSet> descriptorSets;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+
+        std::vector<VkBuffer> objectBuffers;
+        std::vector<VkBuffer> commandBuffers;
+        std::vector<Allocation> commandAllocations;
+        std::vector<VkBuffer> countBuffers;
+        std::vector<Allocation> countAllocations;
+        uint32_t capacity = 0;
+        uint32_t maxDrawsPerCall = 1;
+        bool useDrawCount = false;
+
+    public:
+        void init(VkPhysicalDevice& physicalDevice, VkDevice& device, DeviceAllocator& allocator, VkPipelineCache pipelineCache,
+                  uint32_t framesInFlight, uint32_t objectCapacity, bool drawIndirectCount, bool multiDrawIndirect) {
+            std::cout << "Initializing GPU culler (" << objectCapacity << " objects)..." << std::endl;
+            capacity = objectCapacity;
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+            maxDrawsPerCall = multiDrawIndirect ? std::max(properties.limits.maxDrawIndirectCount, 1u) : 1;
+            useDrawCount = drawIndirectCount && capacity <= maxDrawsPerCall;
+            if (drawIndirectCount && !useDrawCount) {
+                std::cout << "Culling more objects than maxDrawIndirectCount (" << maxDrawsPerCall
+                          << "), falling back to zero-filled indirect draws." << std::endl;
+            }
+
+            objectBuffers.assign(framesInFlight, VK_NULL_HANDLE);
+            commandBuffers.assign(framesInFlight, VK_NULL_HANDLE);
+            commandAllocations.resize(framesInFlight);
+            countBuffers.assign(framesInFlight, VK_NULL_HANDLE);
+            countAllocations.resize(framesInFlight);
+            for (uint32_t i = 0; i < framesInFlight; i++) {
+                commandAllocations[i] = allocator.createBuffer(sizeof(VkDrawIndexedIndirectCommand) * capacity,
+                                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, commandBuffers[i]);
+                countAllocations[i] = allocator.createBuffer(sizeof(uint32_t),
+                                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, countBuffers[i]);
+            }
+
+            createDescriptors(device, framesInFlight);
+            createPipeline(device, pipelineCache);
+        }
+
+        // Culls the objects in the frame's slot of the instance buffer, which has to hold Instance structures.
+        void setObjects(VkDevice& device, size_t frame, VkBuffer objects) {
+            objectBuffers[frame] = objects;
+            std::array<VkDescriptorBufferInfo, 3> bufferInfos = {};
+            bufferInfos[0] = {objects, 0, VK_WHOLE_SIZE};
+            bufferInfos[1] = {commandBuffers[frame], 0, VK_WHOLE_SIZE};
+            bufferInfos[2] = {countBuffers[frame], 0, VK_WHOLE_SIZE};
+
+            std::array<VkWriteDescriptorSet, 3> writes = {};
+            for (uint32_t binding = 0; binding < writes.size(); binding++) {
+                writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[binding].dstSet = descriptorSets[frame];
+                writes[binding].dstBinding = binding;
+                writes[binding].descriptorCount = 1;
+                writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                writes[binding].pBufferInfo = &bufferInfos[binding];
+            }
+            vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+
+        // Must be recorded outside the render pass, before the draw() that consumes the result. Host writes to the
+        // objects are visible to the dispatch through the queue submission. When cullFamily differs from drawFamily the
+        // closing barrier releases the frame's buffers to drawFamily instead; recordAcquire() must then be recorded on
+        // that family after waiting on the culling submission.
+        void record(VkCommandBuffer commandBuffer, size_t frame, const Frustum& frustum, uint32_t objectCount,
+                    uint32_t indexCount, float boundingRadius,
+                    uint32_t cullFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t drawFamily = VK_QUEUE_FAMILY_IGNORED) {
+            vkCmdFillBuffer(commandBuffer, countBuffers[frame], 0, VK_WHOLE_SIZE, 0);
+            if (!useDrawCount) {
+                vkCmdFillBuffer(commandBuffer, commandBuffers[frame], 0, VK_WHOLE_SIZE, 0);
+            }
+
+            VkMemoryBarrier clearBarrier = {};
+            clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+            CullPushConstants constants = {};
+            constants.planes = frustum.planes;
+            constants.objectCount = std::min(objectCount, capacity);
+            constants.indexCount = indexCount;
+            constants.boundingRadius = boundingRadius;
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[frame], 0, nullptr);
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+            vkCmdDispatch(commandBuffer, (constants.objectCount + 63) / 64, 1, 1);
+
+            if (cullFamily == drawFamily) {
+                VkMemoryBarrier drawBarrier = {};
+                drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+                                     1, &drawBarrier, 0, nullptr, 0, nullptr);
+                return;
+            }
+
+            // Release half of the ownership transfer; the destination access and stages are ignored here.
+            std::array<VkBufferMemoryBarrier, 3> barriers = buildOwnershipBarriers(frame, cullFamily, drawFamily,
+                                                                                   VK_ACCESS_SHADER_WRITE_BIT, 0, 0);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+        }
+
+        // Acquire half of the ownership transfer released by record(). The submission containing it must wait on the
+        // culling submission at VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT.
+        void recordAcquire(VkCommandBuffer commandBuffer, size_t frame, uint32_t cullFamily, uint32_t drawFamily) {
+            std::array<VkBufferMemoryBarrier, 3> barriers = buildOwnershipBarriers(frame, cullFamily, drawFamily, 0,
+                                                                                   VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                                                                                   VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                 VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+                                 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+        }
+
+        // Draws the frame's surviving objects with whatever mesh and instance buffer are bound.
+        void draw(VkCommandBuffer commandBuffer, size_t frame) {
+            if (useDrawCount) {
+                vkCmdDrawIndexedIndirectCount(commandBuffer, commandBuffers[frame], 0, countBuffers[frame], 0, capacity,
+                                              sizeof(VkDrawIndexedIndirectCommand));
+                return;
+            }
+            for (uint32_t first = 0; first < capacity; first += maxDrawsPerCall) {
+                uint32_t drawCount = std::min(maxDrawsPerCall, capacity - first);
+                vkCmdDrawIndexedIndirect(commandBuffer, commandBuffers[frame], first * sizeof(VkDrawIndexedIndirectCommand), drawCount,
+                                         sizeof(VkDrawIndexedIndirectCommand));
+            }
+        }
+
+        bool isUsingDrawCount() {
+            return useDrawCount;
+        }
+
+        void cleanup(VkDevice& device, DeviceAllocator& allocator) {
+            vkDestroyPipeline(device, pipeline, nullptr);
+            vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+            vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+            vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+            for (size_t i = 0; i < commandBuffers.size(); i++) {
+                allocator.destroyBuffer(commandBuffers[i], commandAllocations[i]);
+                allocator.destroyBuffer(countBuffers[i], countAllocations[i]);
+            }
+            objectBuffers.clear();
+            commandBuffers.clear();
+            countBuffers.clear();
+            descriptorSets.clear();
+        }
+
+    private:
+        // The draws and their count get drawAccess on the destination side, the objects objectAccess.
+        std::array<VkBufferMemoryBarrier, 3> buildOwnershipBarriers(size_t frame, uint32_t srcFamily, uint32_t dstFamily,
+                                                                    VkAccessFlags srcAccess, VkAccessFlags drawAccess,
+                                                                    VkAccessFlags objectAccess) {
+            std::array<VkBuffer, 3> buffers = {commandBuffers[frame], countBuffers[frame], objectBuffers[frame]};
+            // The dispatch only reads the objects.
+            std::array<VkAccessFlags, 3> srcAccesses = {srcAccess, srcAccess, 0};
+            std::array<VkAccessFlags, 3> dstAccesses = {drawAccess, drawAccess, objectAccess};
+            std::array<VkBufferMemoryBarrier, 3> barriers = {};
+            for (size_t i = 0; i < barriers.size(); i++) {
+                barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barriers[i].srcAccessMask = srcAccesses[i];
+                barriers[i].dstAccessMask = dstAccesses[i];
+                barriers[i].srcQueueFamilyIndex = srcFamily;
+                barriers[i].dstQueueFamilyIndex = dstFamily;
+                barriers[i].buffer = buffers[i];
+                barriers[i].offset = 0;
+                barriers[i].size = VK_WHOLE_SIZE;
+            }
+            return barriers;
+        }
+
+        // Binding 0 holds the objects, 1 the draw commands and 2 the draw count.
+        void createDescriptors(VkDevice& device, uint32_t framesInFlight) {
+            std::array<VkDescriptorSetLayoutBinding, 3> bindings = {};
+            for (uint32_t binding = 0; binding < bindings.size(); binding++) {
+                bindings[binding].binding = binding;
+                bindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                bindings[binding].descriptorCount = 1;
+                bindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            }
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+            layoutInfo.pBindings = bindings.data();
+            if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create culling descriptor set layout!");
+            }
+
+            VkDescriptorPoolSize poolSize = {};
+            poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            poolSize.descriptorCount = static_cast<uint32_t>(bindings.size()) * framesInFlight;
+
+            VkDescriptorPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.maxSets = framesInFlight;
+            poolInfo.poolSizeCount = 1;
+            poolInfo.pPoolSizes = &poolSize;
+            if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create culling descriptor pool!");
+            }
+
+            std::vector<VkDescriptorSetLayout> layouts(framesInFlight, setLayout);
+            VkDescriptorSetAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = descriptorPool;
+            allocInfo.descriptorSetCount = framesInFlight;
+            allocInfo.pSetLayouts = layouts.data();
+            descriptorSets.resize(framesInFlight);
+            if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate culling descriptor sets!");
+            }
+        }
+
+        void createPipeline(VkDevice& device, VkPipelineCache pipelineCache) {
+            VkPushConstantRange pushConstantRange = {};
+            pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            pushConstantRange.offset = 0;
+            pushConstantRange.size = sizeof(CullPushConstants);
+
+            VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+            pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pipelineLayoutInfo.setLayoutCount = 1;
+            pipelineLayoutInfo.pSetLayouts = &setLayout;
+            pipelineLayoutInfo.pushConstantRangeCount = 1;
+            pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+            if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create culling pipeline layout!");
+            }
+
+            VkShaderModule shaderModule = createShaderModule(device, shaders::cullComp);
+
+            VkComputePipelineCreateInfo pipelineInfo = {};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipelineInfo.stage.module = shaderModule;
+            pipelineInfo.stage.pName = "main";
+            pipelineInfo.layout = pipelineLayout;
+
+            VkResult result = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+            vkDestroyShaderModule(device, shaderModule, nullptr);
+            if (result != VK_SUCCESS) {
+                throw std::runtime_error("failed to create culling pipeline!");
+            }
+        }
+    };
+#endif
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#ifndef BINDLESS_TABLE
+#define BINDLESS_TABLE
+    // Hands out the indices of a fixed size array. Released indices are reused before new ones, so handles stay
+    // small and dense. Each handle has a live bit, so releasing one that was never allocated or is already released
+    // throws instead of handing the same index out twice.
+    class HandleAllocator {
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<uint32_t> released;
+        std::vector<bool> live;
+
+    public:
+        void init(uint32_t handleCapacity) {
+            capacity = handleCapacity;
+            next = 0;
+            released.clear();
+            live.assign(capacity, false);
+        }
+
+        uint32_t allocate() {
+            if (!released.empty()) {
+                uint32_t handle = released.back();
+                released.pop_back();
+                live[handle] = true;
+                return handle;
+            }
+            if (next == capacity) {
+                throw std::runtime_error("out of bindless handles!");
+            }
+            live[next] = true;
+            return next++;
+        }
+
+        void release(uint32_t handle) {
+            if (handle >= next || !live[handle]) {
+                throw std::runtime_error("released a bindless handle that is not allocated!");
+            }
+            live[handle] = false;
+            released.push_back(handle);
+        }
+
+        uint32_t getLiveCount() {
+            return next - static_cast<uint32_t>(released.size());
+        }
+    };
+
+    // One global descriptor set holding every image and storage buffer a frame may touch, in two large arrays:
+    // binding 0 for combined image samplers, binding 1 for storage buffers. Resources are registered once and
+    // identified by a stable integer handle, which draws pass to shaders in push constants; recording then binds this
+    // one set per command buffer instead of a set per draw or material.
+    //
+    // The bindings are update-after-bind, partially bound and updatable while unused by pending work (Vulkan 1.2
+    // descriptor indexing), so registering a resource never waits on frames in flight. A released handle may still be
+    // read by a frame in flight, so release it through the deletion queue. Only used from the render thread.
+    class BindlessTable {
+        static const uint32_t imageBinding = 0;
+        static const uint32_t bufferBinding = 1;
+
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        HandleAllocator images;
+        HandleAllocator buffers;
+
+    public:
+        // Capacities are clamped to the device's update-after-bind limits.
+        void init(VkPhysicalDevice& physicalDevice, VkDevice& device, uint32_t imageCapacity, uint32_t bufferCapacity, VkShaderStageFlags stages) {
+            VkPhysicalDeviceVulkan12Properties vulkan12Properties = {};
+            vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+            VkPhysicalDeviceProperties2 properties = {};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties.pNext = &vulkan12Properties;
+            vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+            // A combined image sampler counts as both a sampled image and a sampler.
+            imageCapacity = std::min({imageCapacity,
+                                      vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                      vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                      vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                      vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers});
+            bufferCapacity = std::min({bufferCapacity,
+                                       vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                       vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageBuffers});
+            std::cout << "Initializing bindless table (" << imageCapacity << " images, " << bufferCapacity << " buffers)..." << std::endl;
+
+            images.init(imageCapacity);
+            buffers.init(bufferCapacity);
+            createDescriptors(device, imageCapacity, bufferCapacity, stages);
+        }
+
+        uint32_t addImage(VkDevice& device, VkImageView view, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+            uint32_t handle = images.allocate();
+            VkDescriptorImageInfo imageInfo = {};
+            imageInfo.sampler = sampler;
+            imageInfo.imageView = view;
+            imageInfo.imageLayout = layout;
+            write(device, imageBinding, handle, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &imageInfo, nullptr);
+            return handle;
+        }
+
+        uint32_t addBuffer(VkDevice& device, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE) {
+            uint32_t handle = buffers.allocate();
+            VkDescriptorBufferInfo bufferInfo = {};
+            bufferInfo.buffer = buffer;
+            bufferInfo.offset = offset;
+            bufferInfo.range = range;
+            write(device, bufferBinding, handle, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo);
+            return handle;
+        }
+
+        void releaseImage(uint32_t handle) {
+            images.release(handle);
+        }
+
+        void releaseBuffer(uint32_t handle) {
+            buffers.release(handle);
+        }
+
+        void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set) {
+            vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, set, 1, &descriptorSet, 0, nullptr);
+        }
+
+        VkDescriptorSetLayout getSetLayout() {
+            return setLayout;
+        }
+
+        uint32_t getLiveHandles() {
+            return images.getLiveCount() + buffers.getLiveCount();
+        }
+
+        void cleanup(VkDevice& device) {
+            vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+            vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+            descriptorSet = VK_NULL_HANDLE;
+        }
+
+    private:
+        void write(VkDevice& device, uint32_t binding, uint32_t handle, VkDescriptorType type,
+                   const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo) {
+            VkWriteDescriptorSet write = {};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = descriptorSet;
+            write.dstBinding = binding;
+            write.dstArrayElement = handle;
+            write.descriptorCount = 1;
+            write.descriptorType = type;
+            write.pImageInfo = imageInfo;
+            write.pBufferInfo = bufferInfo;
+            vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        }
+
+        void createDescriptors(VkDevice& device, uint32_t imageCapacity, uint32_t bufferCapacity, VkShaderStageFlags stages) {
+            std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+            bindings[imageBinding].binding = imageBinding;
+            bindings[imageBinding].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            bindings[imageBinding].descriptorCount = imageCapacity;
+            bindings[imageBinding].stageFlags = stages;
+            bindings[bufferBinding].binding = bufferBinding;
+            bindings[bufferBinding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[bufferBinding].descriptorCount = bufferCapacity;
+            bindings[bufferBinding].stageFlags = stages;
+
+            // Unwritten entries are fine as long as nothing reads them.
+            VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                             VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+            std::array<VkDescriptorBindingFlags, 2> bindingFlags = {flags, flags};
+            VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+            bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+            bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+            bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.pNext = &bindingFlagsInfo;
+            layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+            layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+            layoutInfo.pBindings = bindings.data();
+            if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create bindless descriptor set layout!");
+            }
+
+            std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+            poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            poolSizes[0].descriptorCount = imageCapacity;
+            poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            poolSizes[1].descriptorCount = bufferCapacity;
+
+            VkDescriptorPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+            poolInfo.maxSets = 1;
+            poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+            poolInfo.pPoolSizes = poolSizes.data();
+            if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create bindless descriptor pool!");
+            }
+
+            VkDescriptorSetAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = descriptorPool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &setLayout;
+            if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate bindless descriptor set!");
+            }
+        }
+    };
+#endif
@@ -0,0 +1,37 @@
+#include <array>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#ifndef INSTANCE
+#define INSTANCE
+    // Per-instance vertex input, read from binding 1 once per instance rather than once per vertex.
+    struct Instance {
+        glm::vec4 transform; // xy offset, z scale, w rotation in radians
+        glm::vec4 color;     // multiplies the vertex color
+
+        static VkVertexInputBindingDescription getBindingDescription() {
+            VkVertexInputBindingDescription bindingDescription = {};
+            bindingDescription.binding = 1;
+            bindingDescription.stride = sizeof(Instance);
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+            return bindingDescription;
+        }
+
+        // Locations continue after the Vertex attributes.
+        static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
+            std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+
+            attributeDescriptions[0].binding = 1;
+            attributeDescriptions[0].location = 2;
+            attributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[0].offset = offsetof(Instance, transform);
+
+            attributeDescriptions[1].binding = 1;
+            attributeDescriptions[1].location = 3;
+            attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[1].offset = offsetof(Instance, color);
+
+            return attributeDescriptions;
+        }
+    };
+#endif
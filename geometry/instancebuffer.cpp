@@ -0,0 +1,61 @@
+#include <iostream>
+#include <vector>
+#include "instance.cpp"
+#include "deviceallocator.cpp"
+
+#ifndef INSTANCE_BUFFER
+#define INSTANCE_BUFFER
+    // Per-instance data rewritten by the CPU every frame. Each frame in flight has its own persistently mapped buffer,
+    // so the CPU fills one while the GPU still reads the others and no copy or staging is needed: the draws read the
+    // mapped memory directly. A slot may be rewritten once the frame that last used it has completed.
+    class InstanceBuffer {
+        std::vector<VkBuffer> buffers;
+        std::vector<Allocation> allocations;
+        uint32_t capacity = 0;
+
+    public:
+        void init(DeviceAllocator& allocator, uint32_t framesInFlight, uint32_t instanceCapacity) {
+            std::cout << "Initializing instance buffer (" << instanceCapacity << " instances)..." << std::endl;
+            capacity = instanceCapacity;
+            buffers.assign(framesInFlight, VK_NULL_HANDLE);
+            allocations.resize(framesInFlight);
+            for (uint32_t i = 0; i < framesInFlight; i++) {
+                allocations[i] = allocator.createBuffer(sizeof(Instance) * capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                        buffers[i]);
+            }
+        }
+
+        // The frame's capacity instances, written in place. Memory is host coherent, so no flush is needed before
+        // the frame is submitted.
+        Instance* getInstances(size_t frame) {
+            return static_cast<Instance*>(allocations[frame].mapped);
+        }
+
+        void bind(VkCommandBuffer commandBuffer, size_t frame) {
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(commandBuffer, Instance::getBindingDescription().binding, 1, &buffers[frame], &offset);
+        }
+
+        // Also readable as a storage buffer, e.g. by the GPU culler.
+        VkBuffer getBuffer(size_t frame) {
+            return buffers[frame];
+        }
+
+        uint32_t getCapacity() {
+            return capacity;
+        }
+
+        VkDeviceSize getFrameSize() {
+            return sizeof(Instance) * capacity;
+        }
+
+        void cleanup(DeviceAllocator& allocator) {
+            for (size_t i = 0; i < buffers.size(); i++) {
+                allocator.destroyBuffer(buffers[i], allocations[i]);
+            }
+            buffers.clear();
+            allocations.clear();
+        }
+    };
+#endif
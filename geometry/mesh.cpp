@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <vector>
+#include <glm/glm.hpp>
+#include "vertex.cpp"
+#include "deviceallocator.cpp"
+#include "stagingring.cpp"
+
+#ifndef MESH
+#define MESH
+    // Indexed geometry in device local memory. The contents arrive through the staging ring, so they are only valid
+    // on the GPU once the ring's copies for the current frame have been submitted.
+    class Mesh {
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        Allocation vertexAllocation;
+        Allocation indexAllocation;
+        uint32_t indexCount = 0;
+        float boundingRadius = 0.0f;
+
+    public:
+        void init(DeviceAllocator& allocator, StagingRing& stagingRing, const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices) {
+            indexCount = static_cast<uint32_t>(indices.size());
+            for (const Vertex& vertex : vertices) {
+                boundingRadius = std::max(boundingRadius, glm::length(vertex.pos));
+            }
+
+            VkDeviceSize vertexSize = sizeof(vertices[0]) * vertices.size();
+            vertexAllocation = allocator.createBuffer(vertexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer);
+
+            VkDeviceSize indexSize = sizeof(indices[0]) * indices.size();
+            indexAllocation = allocator.createBuffer(indexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer);
+
+            if (!stagingRing.upload(vertices.data(), vertexSize, vertexBuffer, 0) ||
+                !stagingRing.upload(indices.data(), indexSize, indexBuffer, 0)) {
+                throw std::runtime_error("staging ring is full!");
+            }
+        }
+
+        void bind(VkCommandBuffer commandBuffer) {
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+        }
+
+        void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0) {
+            vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
+        }
+
+        uint32_t getIndexCount() {
+            return indexCount;
+        }
+
+        // Radius of a sphere around the origin containing every vertex.
+        float getBoundingRadius() {
+            return boundingRadius;
+        }
+
+        void cleanup(DeviceAllocator& allocator) {
+            allocator.destroyBuffer(vertexBuffer, vertexAllocation);
+            allocator.destroyBuffer(indexBuffer, indexAllocation);
+        }
+    };
+#endif
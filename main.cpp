@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 #include <filesystem>
@@ -11,15 +12,43 @@
 #include <assert.h>
 
 #include "swapchain.cpp"
-#include "framebuffer.cpp"
-#include "renderpass.cpp"
+#include "deviceallocator.cpp"
+#include "stagingring.cpp"
+#include "uniformring.cpp"
+#include "bindlesstable.cpp"
+#include "mesh.cpp"
+#include "instancebuffer.cpp"
+#include "gpuculler.cpp"
+#include "cpuculler.cpp"
+#include "cullbenchmark.cpp"
+#include "offscreentarget.cpp"
+#include "rendergraph.cpp"
+#include "pipelinecache.cpp"
 #include "graphicspipeline.cpp"
+#include "pipelinevariants.cpp"
+#include "shaderreloader.cpp"
 #include "queuemanager.cpp"
 #include "syncobjects.cpp"
+#include "options.cpp"
+#include "benchmark.cpp"
+#include "gpuprofiler.cpp"
+#include "parallelrecorder.cpp"
+#include "deletionqueue.cpp"
+#include "framepacer.cpp"
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
+const std::vector<Vertex> vertices = {
+        {{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+        {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+        {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+};
+
+const std::vector<uint16_t> indices = {
+        0, 1, 2
+};
+
 const std::vector<const char*> validationLayers = {
         "VK_LAYER_KHRONOS_validation"
 };
@@ -51,11 +80,11 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
     }
 }
 
-VkSubmitInfo buildSubmitInfo(VkCommandBuffer& commandBuffers) {
+VkSubmitInfo buildSubmitInfo(std::vector<VkCommandBuffer>& commandBuffers) {
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers;
+    submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
     return submitInfo;
 }
 
@@ -72,17 +101,22 @@ VkPresentInfoKHR buildPresentInfo(VkSwapchainKHR& swapChain, uint32_t &imageInde
 
 class HelloTriangleApplication {
 public:
-    HelloTriangleApplication() {}
+    HelloTriangleApplication(AppOptions options) : options(options) {}
 
     void run() {
-        initWindow();
+        if (!options.headless) {
+            initWindow();
+        }
         initVulkan();
         mainLoop();
         cleanup();
     }
 
 private:
+    AppOptions options;
+
     GLFWwindow* window;
+    bool framebufferResized = false;
     VkSurfaceKHR surface;
     VkInstance instance;
 
@@ -90,43 +124,162 @@ private:
     QueueFamilyIndices queueFamilyIndices;
 
     VkDevice device;
+    DeviceAllocator deviceAllocator;
     VkDebugUtilsMessengerEXT debugMessenger;
 
     VkCommandPool commandPool;
-    std::vector<VkCommandBuffer> commandBuffers;
+    std::vector<FrameContext> frameContexts;
+    ParallelRecorder parallelRecorder;
 
     size_t currentFrame = 0;
+    uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+    PresentPolicy presentPolicy = PresentPolicy::Vsync;
+    FramePacer framePacer;
+    uint32_t lastImageIndex = 0;
 
     SwapChain swapChain;
+    OffscreenTarget offscreenTarget;
     std::vector<VkSemaphore> imageAvailableSemaphores;
+    AssetLoader assetLoader;
+    PipelineCache pipelineCache;
+    PipelineCompiler pipelineCompiler;
+    PipelineVariantCache pipelineVariants;
+    ShaderReloader shaderReloader;
+    // SPIR-V mapped by the shader reloader. The live files back graphicsPipeline's shaders, the pending ones the
+    // pipeline being rebuilt from them.
+    std::map<std::string, MappedAsset> liveShaderFiles;
+    std::map<std::string, MappedAsset> pendingShaderFiles;
+    GraphicsPipelineDescription reloadDescription;
+    std::shared_future<CompiledPipeline> pendingReload;
+    uint32_t shaderReloads = 0;
     GraphicsPipeline graphicsPipeline;
-    FrameBuffer frameBuffer;
+    RenderGraph renderGraph;
+    RenderGraphImage targetImage = 0;
+    RenderGraphPass scenePass = 0;
+    // The current frame's draws, executed by the scene pass.
+    std::vector<VkCommandBuffer> sceneCommandBuffers;
     QueueManager queueManager;
+    FrameBenchmark benchmark;
+    GpuProfiler gpuProfiler;
+    bool pipelineStatisticsEnabled = false;
+    bool inheritedQueriesEnabled = false;
+    bool timelineSemaphoresEnabled = false;
+    bool drawIndirectCountEnabled = false;
+    bool multiDrawIndirectEnabled = false;
+    std::vector<bool> frameSlots;
+    std::vector<bool> uploadSlots;
+
+    uint32_t imageWaits = 0;
+    DeletionQueue deletionQueue;
+
+    StagingRing stagingRing;
+    UniformRing uniformRing;
+    BindlessTable bindlessTable;
+    // Bindless handle of each frame's slot in the instance buffer.
+    std::vector<uint32_t> instanceBufferHandles;
+    Mesh mesh;
+    InstanceBuffer instanceBuffer;
+    GpuCuller gpuCuller;
+    CpuCuller cpuCuller;
+    // With CPU culling the scene lives here and only the visible instances are copied to the instance buffer.
+    std::vector<Instance> sceneInstances;
+    SphereBounds sceneBounds;
+    std::vector<uint32_t> visibleInstances;
+    uint32_t drawnInstances = 0;
+    VkBuffer uploadStressBuffer = VK_NULL_HANDLE;
+    Allocation uploadStressAllocation;
+    std::vector<char> uploadStressData;
 
     void initWindow() {
         glfwInit();
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
         window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan Base", nullptr, nullptr);
+        glfwSetWindowUserPointer(window, this);
+        glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+    }
+
+    static void framebufferResizeCallback(GLFWwindow* resizedWindow, int width, int height) {
+        auto application = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(resizedWindow));
+        application->framebufferResized = true;
     }
 
     void initVulkan() {
+        // The pipeline cache file is read in the background while the instance and device are created.
+        assetLoader.init(1);
+        pipelineCache.prefetch(assetLoader, options.pipelineCachePath);
         createInstance();
         setupDebugMessenger();
-        createSurface();
+        if (!options.headless) {
+            createSurface();
+        }
         pickPhysicalDevice();
         createLogicalDevice();
-        swapChain.init(physicalDevice, device, surface, WIDTH, HEIGHT, queueFamilyIndices);
-        graphicsPipeline.init(device, swapChain.getExtent(), swapChain.getImageFormat());
-        frameBuffer.init(device, swapChain, graphicsPipeline.getRenderPass());
-        queueManager.init(device, queueFamilyIndices);
+        deviceAllocator.init(physicalDevice, device);
+        pipelineCache.init(physicalDevice, device, options.pipelineCachePath);
+        pipelineCompiler.init(device, pipelineCache.getCache(), options.compileThreads > 0 ? options.compileThreads : ThreadPool::defaultThreadCount());
+        pipelineVariants.init(pipelineCompiler);
+        if (options.headless) {
+            framesInFlight = options.framesInFlight > 0 ? options.framesInFlight : DEFAULT_FRAMES_IN_FLIGHT;
+            // One offscreen image per frame in flight, left ready for readback instead of presentation.
+            offscreenTarget.init(deviceAllocator, device, WIDTH, HEIGHT, framesInFlight);
+        } else {
+            presentPolicy = parsePresentPolicy(options.presentPolicy);
+            swapChain.init(physicalDevice, device, surface, WIDTH, HEIGHT, queueFamilyIndices, presentPolicy);
+            framesInFlight = options.framesInFlight > 0 ? options.framesInFlight : swapChain.getPresentConfig().framesInFlight;
+        }
+        // One DrawUniforms block per draw call.
+        uniformRing.init(physicalDevice, device, deviceAllocator, static_cast<uint32_t>(framesInFlight), sizeof(DrawUniforms),
+                         std::max(options.drawCount, 1u), VK_SHADER_STAGE_VERTEX_BIT);
+        std::vector<VkDescriptorSetLayout> setLayouts = {uniformRing.getSetLayout()};
+        if (options.bindless) {
+            bindlessTable.init(physicalDevice, device, 4096, 4096, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+            setLayouts.push_back(bindlessTable.getSetLayout());
+        }
+        createRenderGraph();
+        graphicsPipeline.init(device, renderGraph.getRenderPass(scenePass), setLayouts);
+        if (options.bindless) {
+            graphicsPipeline.setShaders(shaders::bindlessVert, shaders::triangleFrag);
+        }
+        std::cout << "Using " << framesInFlight << " frames in flight." << std::endl;
+        frameSlots.assign(framesInFlight, false);
+        uploadSlots.assign(framesInFlight, false);
+
+        // The pipeline compiles on a worker while the remaining device objects are created.
+        std::shared_future<CompiledPipeline> pendingPipeline = pipelineVariants.request(describePipeline());
+
+        renderGraph.build(device, deviceAllocator, getTargetExtent(), getTargetImages(), getTargetImageViews());
+        queueManager.init(device, queueFamilyIndices, framesInFlight, timelineSemaphoresEnabled);
+        queueManager.resetImagesInFlight(getTargetSize());
+        if (isGpuProfiling()) {
+            // One slot per frame command buffer plus one per upload command buffer.
+            gpuProfiler.init(physicalDevice, device, queueFamilyIndices.graphicsFamily.value(), framesInFlight * 2,
+                             pipelineStatisticsEnabled, inheritedQueriesEnabled);
+        }
         createCommandPool();
-        createCommandBuffers();
+        parallelRecorder.init(options.recordThreads > 0 ? options.recordThreads : ThreadPool::defaultThreadCount());
+        createFrameContexts();
+        createGeometry();
+        if (options.gpuCull) {
+            createCuller();
+        }
+        if (options.cpuCull) {
+            cpuCuller.init(ThreadPool::defaultThreadCount());
+            sceneInstances.resize(instanceBuffer.getCapacity());
+            sceneBounds.resize(instanceBuffer.getCapacity());
+        }
+        if (options.hotReload) {
+            shaderReloader.init({vertexShaderName(), "shader.frag"});
+        }
 
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+        imageAvailableSemaphores.resize(framesInFlight);
         createSemaphores(device, imageAvailableSemaphores);
+
+        const CompiledPipeline& compiled = pendingPipeline.get();
+        std::cout << "Compiled pipeline " << compiled.name << " in " << compiled.compileMilliseconds << " ms" << std::endl;
+        graphicsPipeline.setPipeline(compiled.pipeline);
     }
 
     void createInstance() {
@@ -140,7 +293,9 @@ private:
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // Vulkan 1.2 features (timeline semaphores, indirect count draws) are used when available; a 1.0 loader
+        // rejects any higher version.
+        appInfo.apiVersion = std::min(getInstanceApiVersion(), static_cast<uint32_t>(VK_API_VERSION_1_2));
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -169,6 +324,16 @@ private:
 
     }
 
+    // vkEnumerateInstanceVersion only exists from Vulkan 1.1 on.
+    static uint32_t getInstanceApiVersion() {
+        auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+        uint32_t apiVersion = VK_API_VERSION_1_0;
+        if (enumerateInstanceVersion != nullptr) {
+            enumerateInstanceVersion(&apiVersion);
+        }
+        return apiVersion;
+    }
+
     static bool checkValidationLayerSupport() {
         uint32_t layerCount;
         vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
@@ -194,12 +359,15 @@ private:
         return true;
     }
 
-    static std::vector<const char*> getRequiredExtensions() {
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> getRequiredExtensions() {
+        std::vector<const char*> extensions;
 
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        if (!options.headless) {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -239,6 +407,10 @@ private:
     bool deviceIsSuitable(VkPhysicalDevice availableDevice) {
         QueueFamilyIndices indices = findQueueFamilies(availableDevice);
 
+        if (options.headless) {
+            return indices.isComplete(false);
+        }
+
         bool extensionsSupported = checkDeviceExtensionSupport(availableDevice);
 
         bool swapChainAdequate = false;
@@ -250,6 +422,13 @@ private:
         return indices.isComplete() && extensionsSupported && swapChainAdequate;
     }
 
+    std::vector<const char*> getDeviceExtensions() {
+        if (options.headless) {
+            return {};
+        }
+        return deviceExtensions;
+    }
+
     static bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
         uint32_t extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -275,20 +454,36 @@ private:
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(availableDevice, &queueFamilyCount, queueFamilies.data());
 
+        // Every family is visited so dedicated transfer and compute families are found even after graphics and
+        // present are settled.
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            if (queueFamily.queueCount == 0) {
+                i++;
+                continue;
+            }
+
+            bool graphics = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+            bool compute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+            bool transfer = queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
+
+            if (graphics && !indices.isComplete(!options.headless)) {
                 indices.graphicsFamily = i;
             }
 
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(availableDevice, i, surface, &presentSupport);
-            if(queueFamily.queueCount > 0 && presentSupport){
-                indices.presentFamily = i;
+            if (!options.headless && !indices.presentFamily.has_value()) {
+                VkBool32 presentSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(availableDevice, i, surface, &presentSupport);
+                if (presentSupport) {
+                    indices.presentFamily = i;
+                }
             }
 
-            if (indices.isComplete()) {
-                break;
+            if (transfer && !graphics && !compute && !indices.transferFamily.has_value()) {
+                indices.transferFamily = i;
+            }
+            if (compute && !graphics && !indices.computeFamily.has_value()) {
+                indices.computeFamily = i;
             }
 
             i++;
@@ -297,9 +492,33 @@ private:
         return indices;
     }
 
+    // All false unless both the instance and the device are Vulkan 1.2.
+    VkPhysicalDeviceVulkan12Features getSupportedVulkan12Features() {
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        if (getInstanceApiVersion() < VK_API_VERSION_1_2 || properties.apiVersion < VK_API_VERSION_1_2) {
+            return vulkan12Features;
+        }
+
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+        vulkan12Features.pNext = nullptr;
+        return vulkan12Features;
+    }
+
     void createLogicalDevice() {
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.presentFamily.value()};
+        std::set<uint32_t> uniqueQueueFamilies = {queueFamilyIndices.graphicsFamily.value()};
+        for (auto& family : {queueFamilyIndices.presentFamily, queueFamilyIndices.transferFamily, queueFamilyIndices.computeFamily}) {
+            if (family.has_value()) {
+                uniqueQueueFamilies.insert(family.value());
+            }
+        }
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -311,18 +530,73 @@ private:
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
+        if (isGpuProfiling() && supportedFeatures.pipelineStatisticsQuery) {
+            deviceFeatures.pipelineStatisticsQuery = VK_TRUE;
+            pipelineStatisticsEnabled = true;
+            // Lets the frame's statistics query stay active around the secondaries that hold the draws.
+            if (supportedFeatures.inheritedQueries) {
+                deviceFeatures.inheritedQueries = VK_TRUE;
+                inheritedQueriesEnabled = true;
+            }
+        }
+
+        VkPhysicalDeviceVulkan12Features supportedVulkan12Features = getSupportedVulkan12Features();
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        if (options.timelineSync) {
+            timelineSemaphoresEnabled = supportedVulkan12Features.timelineSemaphore == VK_TRUE;
+            vulkan12Features.timelineSemaphore = supportedVulkan12Features.timelineSemaphore;
+            if (!timelineSemaphoresEnabled) {
+                std::cout << "Timeline semaphores are not supported, falling back to fences." << std::endl;
+            }
+        }
+        if (options.bindless) {
+            bool supported = supportedVulkan12Features.runtimeDescriptorArray && supportedVulkan12Features.descriptorBindingPartiallyBound &&
+                             supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+                             supportedVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind &&
+                             supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending;
+            if (!supported) {
+                throw std::runtime_error("bindless descriptors need Vulkan 1.2 descriptor indexing!");
+            }
+            vulkan12Features.descriptorIndexing = supportedVulkan12Features.descriptorIndexing;
+            vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+            vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+            vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            // Lets fragment shaders index textures by per-material handles that differ within a draw.
+            vulkan12Features.shaderSampledImageArrayNonUniformIndexing = supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+        }
+        if (options.gpuCull) {
+            drawIndirectCountEnabled = supportedVulkan12Features.drawIndirectCount == VK_TRUE;
+            vulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+            if (!drawIndirectCountEnabled) {
+                if (!supportedFeatures.multiDrawIndirect) {
+                    throw std::runtime_error("GPU culling needs drawIndirectCount or multiDrawIndirect!");
+                }
+                std::cout << "Indirect count draws are not supported, falling back to zero-filled indirect draws." << std::endl;
+            }
+            deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+            multiDrawIndirectEnabled = supportedFeatures.multiDrawIndirect == VK_TRUE;
+        }
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        // Only chained when something in it is enabled, since the structure is invalid below Vulkan 1.2.
+        createInfo.pNext = timelineSemaphoresEnabled || drawIndirectCountEnabled || options.bindless ? &vulkan12Features : nullptr;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        std::vector<const char*> enabledExtensions = getDeviceExtensions();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         if (enableValidationLayers) {
             createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -342,77 +616,604 @@ private:
         }
     }
 
+    // Only used for one-off commands outside the frame loop, such as the headless readback.
     void createCommandPool(){
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-        poolInfo.flags = 0; // Optional
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
         if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
     }
 
-    void createCommandBuffers(){
-        commandBuffers.resize(swapChain.getSize());
+    // Every command buffer recorded in the frame loop comes from the frame context of its frame in flight.
+    void createFrameContexts(){
+        frameContexts.resize(framesInFlight);
+        for (auto& frame : frameContexts) {
+            frame.init(device, queueManager.getGraphicsFamily(), queueManager.getTransferFamily(), queueManager.getComputeFamily(),
+                       parallelRecorder.getThreadCount());
+        }
+    }
+
+    // Geometry is queued on the staging ring here and reaches the GPU with the first frame's submission.
+    void createGeometry(){
+        VkDeviceSize stressSize = static_cast<VkDeviceSize>(options.uploadStressKilobytes) * 1024;
+        // Room for the initial geometry plus the stress upload of every frame in flight and the one being recorded.
+        stagingRing.init(deviceAllocator, 16 * 1024 * 1024 + stressSize * (framesInFlight + 1), framesInFlight);
+
+        mesh.init(deviceAllocator, stagingRing, vertices, indices);
+        instanceBuffer.init(deviceAllocator, framesInFlight, options.instanceCount);
+        if (options.bindless) {
+            for (size_t frame = 0; frame < framesInFlight; frame++) {
+                instanceBufferHandles.push_back(bindlessTable.addBuffer(device, instanceBuffer.getBuffer(frame)));
+            }
+        }
+
+        if (stressSize > 0) {
+            uploadStressData.assign(stressSize, 0x5a);
+            uploadStressAllocation = deviceAllocator.createBuffer(stressSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, uploadStressBuffer);
+        }
+    }
+
+    // Runs at the start of a frame, before anything is recorded. Once a pipeline rebuilt from reloaded shaders has
+    // compiled it replaces the current one, which is evicted from the variant cache and retired after the frames
+    // already submitted with it complete, so repeated edits do not accumulate pipelines.
+    // Otherwise starts a rebuild if the reloader has new shaders; the compile runs on the pipeline compiler's workers,
+    // so rendering carries on with the old pipeline in the meantime.
+    void applyShaderReloads(){
+        if (pendingReload.valid()) {
+            if (!PipelineCompiler::isReady(pendingReload)) {
+                return;
+            }
+            VkPipeline reloaded = VK_NULL_HANDLE;
+            try {
+                reloaded = pendingReload.get().pipeline;
+            } catch (const std::exception& exception) {
+                std::cout << "Failed to rebuild the pipeline, keeping the previous one: " << exception.what() << std::endl;
+            }
+            pendingReload = std::shared_future<CompiledPipeline>();
+            if (reloaded == VK_NULL_HANDLE) {
+                // Drops the failed variant, so fixing the shader and reverting to the same source recompiles it.
+                pipelineVariants.evict(reloadDescription);
+                return;
+            }
 
-        VkCommandBufferAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t) commandBuffers.size();
+            // Saving a shader without changing it hands back the pipeline in use.
+            if (reloaded != graphicsPipeline.getPipeline()) {
+                VkPipeline retiredPipeline = pipelineVariants.evict(describePipeline());
+                deletionQueue.push(queueManager.getSubmittedValue(), [this, retiredPipeline]() {
+                    vkDestroyPipeline(device, retiredPipeline, nullptr);
+                });
+            }
+            graphicsPipeline.setPipeline(reloaded);
+            graphicsPipeline.setShaders(reloadDescription.vertShader, reloadDescription.fragShader);
+            liveShaderFiles = std::move(pendingShaderFiles);
+            pendingShaderFiles.clear();
+            shaderReloads++;
+            std::cout << "Reloaded shaders." << std::endl;
+            return;
+        }
 
-        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate command buffers!");
+        std::map<std::string, MappedAsset> changed;
+        if (!shaderReloader.takeChanges(changed)) {
+            return;
+        }
+        pendingShaderFiles = liveShaderFiles;
+        for (auto& file : changed) {
+            pendingShaderFiles[file.first] = file.second;
         }
 
-        for (size_t i = 0; i < commandBuffers.size(); i++) {
-            VkCommandBufferBeginInfo beginInfo = {};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-            beginInfo.pInheritanceInfo = nullptr; // Optional
+        reloadDescription = describePipeline();
+        try {
+            auto vert = pendingShaderFiles.find(vertexShaderName());
+            if (vert != pendingShaderFiles.end()) {
+                reloadDescription.vertShader = ShaderCode::mapped(*vert->second);
+            }
+            auto frag = pendingShaderFiles.find("shader.frag");
+            if (frag != pendingShaderFiles.end()) {
+                reloadDescription.fragShader = ShaderCode::mapped(*frag->second);
+            }
+        } catch (const std::exception& exception) {
+            std::cout << "Ignoring reloaded shaders: " << exception.what() << std::endl;
+            pendingShaderFiles.clear();
+            return;
+        }
+        pendingReload = pipelineVariants.request(reloadDescription);
+    }
 
-            if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-                throw std::runtime_error("failed to begin recording command buffer!");
+    // The file in pipeline/shaders the triangle pipeline's vertex stage is built from.
+    std::string vertexShaderName(){
+        return options.bindless ? "bindless.vert" : "shader.vert";
+    }
+
+    // The triangle pipeline variant selected by the options.
+    GraphicsPipelineDescription describePipeline(){
+        GraphicsPipelineDescription description = graphicsPipeline.describe();
+        if (options.bindless) {
+            // bindless.vert reads the instances through the bindless table rather than as vertex attributes.
+            auto attributes = Vertex::getAttributeDescriptions();
+            description.name += ".bindless";
+            description.vertexBindings = {Vertex::getBindingDescription()};
+            description.vertexAttributes.assign(attributes.begin(), attributes.end());
+        }
+        if (options.translucent) {
+            description.name += ".translucent";
+            description.blendEnable = true;
+            description.setConstant(GraphicsPipeline::alphaConstant, 0.5f);
+        }
+        return description;
+    }
+
+    // The culler reads the instances straight from each frame's slot of the instance buffer.
+    void createCuller(){
+        gpuCuller.init(physicalDevice, device, deviceAllocator, pipelineCache.getCache(), framesInFlight, instanceBuffer.getCapacity(),
+                       drawIndirectCountEnabled, multiDrawIndirectEnabled);
+        for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+            gpuCuller.setObjects(device, frame, instanceBuffer.getBuffer(frame));
+        }
+    }
+
+    // Lays the instances out on a square grid covering the target, each slowly spinning. Every instance is rewritten
+    // every frame, which stands in for a scene whose objects all move.
+    void updateInstances(){
+        Instance* instances = options.cpuCull ? sceneInstances.data() : instanceBuffer.getInstances(currentFrame);
+        uint32_t instanceCount = instanceBuffer.getCapacity();
+        uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+        float cellSize = 2.0f / columns;
+        float angle = static_cast<float>(queueManager.getSubmittedValue()) * 0.01f;
+
+        for (uint32_t i = 0; i < instanceCount; i++) {
+            uint32_t column = i % columns;
+            uint32_t row = i / columns;
+            float x = -1.0f + cellSize * (column + 0.5f);
+            float y = -1.0f + cellSize * (row + 0.5f);
+            instances[i].transform = glm::vec4(x, y, cellSize * 0.5f, angle + i * 0.1f);
+            instances[i].color = glm::vec4(0.5f + 0.5f * (column + 1) / columns, 0.5f + 0.5f * (row + 1) / columns, 1.0f, 1.0f);
+            if (options.cpuCull) {
+                sceneBounds.set(i, glm::vec3(x, y, 0.0f), mesh.getBoundingRadius() * cellSize * 0.5f);
             }
+        }
+        drawnInstances = instanceCount;
+    }
 
-            VkRenderPassBeginInfo renderPassInfo = {};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = graphicsPipeline.getRenderPass();
-            renderPassInfo.framebuffer = frameBuffer.getBuffer(i);
-            renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = swapChain.getExtent();
+    // Culls the scene on the CPU and packs the visible instances into the frame's slot of the instance buffer.
+    void cullInstances(){
+        Stopwatch cullTimer;
+        // Instances are placed directly in clip space, so the frustum is the clip volume itself.
+        cpuCuller.cull(sceneBounds, Frustum::fromMatrix(glm::mat4(1.0f)), visibleInstances);
+        benchmark.record("cull", cullTimer.lap());
+        benchmark.record("cull", "objects", sceneBounds.getCount());
+        benchmark.record("cull", "visible", static_cast<double>(visibleInstances.size()));
+
+        Instance* instances = instanceBuffer.getInstances(currentFrame);
+        for (size_t i = 0; i < visibleInstances.size(); i++) {
+            instances[i] = sceneInstances[visibleInstances[i]];
+        }
+        drawnInstances = static_cast<uint32_t>(visibleInstances.size());
+    }
 
-            VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearColor;
+    // The frame as a render graph. The scene pass runs the draws recorded by the parallel recorder, either straight
+    // into the target or, with --render-scale, into a scaled transient image that an upscale pass blits to the target.
+    // The graph takes care of the render passes, layout transitions and barriers in between.
+    void createRenderGraph() {
+        VkFormat format = options.headless ? offscreenTarget.getImageFormat() : swapChain.getImageFormat();
+        // Headless images are read back instead of presented.
+        targetImage = renderGraph.importTarget("target", format,
+                                               options.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+        RenderGraphImage sceneColor = targetImage;
+        if (options.renderScale != 1.0f) {
+            if (!options.headless && (swapChain.getImageUsage() & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0) {
+                throw std::runtime_error("swap chain images cannot be blitted to, --render-scale is not supported!");
+            }
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+            VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                                VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+            if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures) {
+                throw std::runtime_error("target format does not support linear blits, --render-scale is not supported!");
+            }
+            sceneColor = renderGraph.createTransient("scene", format, options.renderScale);
+        }
 
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.getPipeline());
-            vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-            vkCmdEndRenderPass(commandBuffers[i]);
+        scenePass = renderGraph.addPass("scene", true, [this](const PassContext& context) {
+            vkCmdExecuteCommands(context.commandBuffer, static_cast<uint32_t>(sceneCommandBuffers.size()), sceneCommandBuffers.data());
+        }, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        renderGraph.writeColor(scenePass, sceneColor, true, {{0.0f, 0.0f, 0.0f, 1.0f}});
+
+        if (sceneColor != targetImage) {
+            RenderGraphPass upscalePass = renderGraph.addPass("upscale", false, [this, sceneColor](const PassContext& context) {
+                VkExtent2D sceneExtent = renderGraph.getExtent(sceneColor);
+                VkImageBlit blit = {};
+                blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.srcSubresource.layerCount = 1;
+                blit.srcOffsets[1] = {static_cast<int32_t>(sceneExtent.width), static_cast<int32_t>(sceneExtent.height), 1};
+                blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.dstSubresource.layerCount = 1;
+                blit.dstOffsets[1] = {static_cast<int32_t>(context.extent.width), static_cast<int32_t>(context.extent.height), 1};
+                vkCmdBlitImage(context.commandBuffer,
+                               renderGraph.getImage(sceneColor, context.imageIndex), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               renderGraph.getImage(targetImage, context.imageIndex), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1, &blit, VK_FILTER_LINEAR);
+            });
+            renderGraph.use(upscalePass, sceneColor, ImageUsage::TransferRead);
+            renderGraph.use(upscalePass, targetImage, ImageUsage::TransferWrite);
+        }
+        renderGraph.compile(device);
+    }
 
-            if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to record command buffer!");
+    // The draws are recorded into secondary command buffers by the parallel recorder; the primary only runs the
+    // render graph around them, inside the frame's profiler scope.
+    VkCommandBuffer recordFrame(uint32_t imageIndex){
+        FrameContext& frame = frameContexts[currentFrame];
+        VkCommandBuffer commandBuffer = frame.getGraphicsPool().allocate(device);
+        uint32_t slot = static_cast<uint32_t>(currentFrame);
+
+        VkCommandBufferInheritanceInfo inheritance = {};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = renderGraph.getRenderPass(scenePass);
+        inheritance.subpass = 0;
+        inheritance.framebuffer = renderGraph.getFramebuffer(scenePass, imageIndex);
+        inheritance.pipelineStatistics = gpuProfiler.getInheritedStatistics();
+
+        // With GPU culling the whole scene is a single indirect draw.
+        uint32_t recordedDraws = options.gpuCull ? 1 : options.drawCount;
+        VkExtent2D extent = renderGraph.getPassExtent(scenePass);
+
+        // Per-draw uniforms are written here, on the recording thread that owns the ring; the workers only bind the
+        // offsets.
+        std::vector<uint32_t> drawOffsets(recordedDraws);
+        for (uint32_t draw = 0; draw < recordedDraws; draw++) {
+            DrawUniforms* uniforms = uniformRing.push<DrawUniforms>(currentFrame, drawOffsets[draw]);
+            // Instances are placed directly in clip space.
+            uniforms->transform = glm::mat4(1.0f);
+        }
+        benchmark.record("uniforms", "bytes", static_cast<double>(uniformRing.getUsed(currentFrame)));
+
+        sceneCommandBuffers = parallelRecorder.record(device, frame, inheritance, recordedDraws,
+                [this, extent, &drawOffsets](VkCommandBuffer secondary, uint32_t firstDraw, uint32_t drawCount) {
+            vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.getPipeline());
+            setDynamicState(secondary, extent);
+            mesh.bind(secondary);
+            if (options.bindless) {
+                // One global set per command buffer; draws select their resources by handle.
+                bindlessTable.bind(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.getLayout(), 1);
+                DrawPushConstants handles = {};
+                handles.instanceBuffer = instanceBufferHandles[currentFrame];
+                vkCmdPushConstants(secondary, graphicsPipeline.getLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(handles), &handles);
+            } else {
+                instanceBuffer.bind(secondary, currentFrame);
+            }
+            if (options.gpuCull) {
+                uniformRing.bind(secondary, graphicsPipeline.getLayout(), 0, currentFrame, drawOffsets[0]);
+                gpuCuller.draw(secondary, currentFrame);
+                return;
             }
+            // The instances are split evenly over the draws.
+            uint32_t instanceCount = drawnInstances;
+            for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; draw++) {
+                uint32_t firstInstance = static_cast<uint32_t>(static_cast<uint64_t>(instanceCount) * draw / options.drawCount);
+                uint32_t endInstance = static_cast<uint32_t>(static_cast<uint64_t>(instanceCount) * (draw + 1) / options.drawCount);
+                if (endInstance > firstInstance) {
+                    uniformRing.bind(secondary, graphicsPipeline.getLayout(), 0, currentFrame, drawOffsets[draw]);
+                    mesh.draw(secondary, endInstance - firstInstance, firstInstance);
+                }
+            }
+        });
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
+
+        gpuProfiler.resetSlot(commandBuffer, slot);
+        // Without inherited queries no statistics query may be active while the secondaries execute, so the frame
+        // then only gets timestamps and the nested cull scope, if culling runs here, collects the statistics instead.
+        gpuProfiler.beginScope(commandBuffer, slot, "frame", gpuProfiler.canInheritStatistics());
+
+        if (isCullingAsync()) {
+            gpuCuller.recordAcquire(commandBuffer, currentFrame, queueManager.getComputeFamily(), queueManager.getGraphicsFamily());
+        } else if (options.gpuCull) {
+            gpuProfiler.beginScope(commandBuffer, slot, "cull");
+            recordCull(commandBuffer);
+            gpuProfiler.endScope(commandBuffer, slot);
+        }
+
+        renderGraph.execute(commandBuffer, imageIndex);
+
+        gpuProfiler.endScope(commandBuffer, slot);
+        frameSlots[currentFrame] = gpuProfiler.isEnabled();
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
         }
+        return commandBuffer;
+    }
+
+    VkExtent2D& getTargetExtent() {
+        return options.headless ? offscreenTarget.getExtent() : swapChain.getExtent();
+    }
+
+    std::vector<VkImage>& getTargetImages() {
+        return options.headless ? offscreenTarget.getImages() : swapChain.getImages();
+    }
+
+    std::vector<VkImageView>& getTargetImageViews() {
+        return options.headless ? offscreenTarget.getImageViews() : swapChain.getImageViews();
+    }
+
+    size_t getTargetSize() {
+        return options.headless ? offscreenTarget.getSize() : swapChain.getSize();
     }
 
     void drawFrame() {
-        queueManager.waitForFences(device, currentFrame);
+        if (options.headless) {
+            drawOffscreenFrame();
+            return;
+        }
+
+        Stopwatch phaseTimer;
+        beginFrame(phaseTimer);
+
+        uint32_t imageIndex;
+        if (swapChain.acquireNewImage(device, imageAvailableSemaphores[currentFrame], imageIndex) == VK_ERROR_OUT_OF_DATE_KHR) {
+            recreateSwapChain();
+            return;
+        }
+        benchmark.record("acquire", phaseTimer.lap());
 
-        uint32_t imageIndex = swapChain.acquireNewImage(device, imageAvailableSemaphores[currentFrame]);
+        if (queueManager.waitForImage(device, imageIndex, currentFrame)) {
+            imageWaits++;
+        }
+        benchmark.record("image_wait", phaseTimer.lap());
 
-        VkSubmitInfo submitInfo = buildSubmitInfo(commandBuffers[imageIndex]);
-        queueManager.submitToGraphicsQueue(submitInfo, currentFrame, imageAvailableSemaphores);
+        submitFrame(phaseTimer, imageIndex);
 
         VkPresentInfoKHR presentInfo = buildPresentInfo(swapChain.getSwapChain(), imageIndex);
-        queueManager.submitToPresentQueue(presentInfo, currentFrame);
+        VkResult presentResult = queueManager.submitToPresentQueue(presentInfo, currentFrame);
+        benchmark.record("present", phaseTimer.lap());
+
+        incrementFrameCount();
+        if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR || framebufferResized) {
+            framebufferResized = false;
+            recreateSwapChain();
+        }
+    }
+
+    // Headless frames render into the offscreen target's image for currentFrame; the last one is read back after the
+    // frame loop.
+    void drawOffscreenFrame() {
+        Stopwatch phaseTimer;
+        beginFrame(phaseTimer);
+
+        uint32_t imageIndex = static_cast<uint32_t>(currentFrame);
+        submitFrame(phaseTimer, imageIndex);
 
+        lastImageIndex = imageIndex;
         incrementFrameCount();
     }
 
-    void incrementFrameCount() { currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT; }
+    // Waits for currentFrame's previous submission, releases everything it held and reads back its queries.
+    void beginFrame(Stopwatch& phaseTimer) {
+        queueManager.waitForFences(device, currentFrame);
+        benchmark.record("fence_wait", phaseTimer.lap());
+
+        stagingRing.releaseFrame(currentFrame);
+        uniformRing.resetFrame(currentFrame);
+        frameContexts[currentFrame].begin(device);
+        // Frames are numbered by their graphics submission value, see QueueManager.
+        deletionQueue.collect(queueManager.getCompletedValue(device));
+        if (options.hotReload) {
+            applyShaderReloads();
+        }
+        benchmark.record("frame_begin", phaseTimer.lap());
+
+        collectGpuResults();
+        benchmark.record("query_readback", phaseTimer.lap());
+    }
+
+    // Records the frame's uploads and draws into imageIndex and submits them. A windowed frame also waits on the
+    // acquired image and signals the semaphore presentation waits on.
+    void submitFrame(Stopwatch& phaseTimer, uint32_t imageIndex) {
+        std::vector<SemaphoreWait> frameWaits;
+        std::vector<VkCommandBuffer> frameCommandBuffers = recordUploads(frameWaits);
+        benchmark.record("upload", phaseTimer.lap());
+
+        updateInstances();
+        if (options.cpuCull) {
+            cullInstances();
+        }
+        benchmark.record("instances", phaseTimer.lap());
+
+        if (isCullingAsync()) {
+            submitCull(frameWaits);
+            benchmark.record("async_cull", phaseTimer.lap());
+        }
+
+        frameCommandBuffers.push_back(recordFrame(imageIndex));
+        recordCommandBufferCounters();
+        benchmark.record("record", phaseTimer.lap());
+
+        VkSubmitInfo submitInfo = buildSubmitInfo(frameCommandBuffers);
+        queueManager.resetFence(device, currentFrame);
+        if (options.headless) {
+            queueManager.submitToGraphicsQueue(submitInfo, currentFrame, frameWaits);
+        } else {
+            queueManager.submitToGraphicsQueue(submitInfo, currentFrame, imageAvailableSemaphores, frameWaits);
+        }
+        benchmark.record("submit", phaseTimer.lap());
+    }
+
+    // Builds the new swap chain from the old one and retires the old swap chain and the render graph's images and
+    // framebuffers through the deletion queue. They are destroyed once the last frame submitted with them has
+    // completed, so the frames in flight keep running instead of the whole device being drained. Pipelines take their
+    // viewport and scissor from dynamic state and are kept as they are.
+    void recreateSwapChain() {
+        int width = 0;
+        int height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        while (width == 0 || height == 0) {
+            // Minimized; nothing can be presented until the window has a size again.
+            glfwWaitEvents();
+            glfwGetFramebufferSize(window, &width, &height);
+        }
+
+        Stopwatch recreateTimer;
+        SwapChain retiredSwapChain = swapChain;
+        RenderGraph::Resources retiredGraph = renderGraph.releaseResources();
+
+        // The surface format does not change for a surface, so the compiled graph and its render passes stay valid.
+        swapChain = SwapChain();
+        swapChain.init(physicalDevice, device, surface, width, height, queueFamilyIndices, presentPolicy, retiredSwapChain.getSwapChain());
+        renderGraph.build(device, deviceAllocator, swapChain.getExtent(), swapChain.getImages(), swapChain.getImageViews());
+        queueManager.resetImagesInFlight(swapChain.getSize());
+
+        deletionQueue.push(queueManager.getSubmittedValue(), [this, retiredSwapChain, retiredGraph]() mutable {
+            RenderGraph::destroyResources(device, deviceAllocator, retiredGraph);
+            retiredSwapChain.cleanup(device);
+        });
+        benchmark.record("swapchain", "recreate_ms", recreateTimer.lap());
+    }
+
+    bool isGpuProfiling() {
+        return options.gpuProfile || options.benchmarkFrames > 0;
+    }
+
+    // The fence for currentFrame has just been waited on, so the queries of the command buffer it last submitted are
+    // complete and can be read without stalling.
+    void collectGpuResults() {
+        if (frameSlots[currentFrame]) {
+            collectGpuSlot(currentFrame);
+            frameSlots[currentFrame] = false;
+        }
+        if (uploadSlots[currentFrame]) {
+            collectGpuSlot(framesInFlight + currentFrame);
+            uploadSlots[currentFrame] = false;
+        }
+    }
+
+    void collectGpuSlot(uint32_t slot) {
+        if (!gpuProfiler.collect(device, slot)) {
+            return;
+        }
+
+        for (auto& result : gpuProfiler.getResults()) {
+            benchmark.record("gpu_ms", result.name, result.milliseconds);
+            if (result.hasStatistics) {
+                benchmark.record("gpu_statistics", result.name + ".input_vertices", result.inputVertices);
+                benchmark.record("gpu_statistics", result.name + ".vertex_invocations", result.vertexInvocations);
+                benchmark.record("gpu_statistics", result.name + ".clipping_primitives", result.clippingPrimitives);
+                benchmark.record("gpu_statistics", result.name + ".fragment_invocations", result.fragmentInvocations);
+                benchmark.record("gpu_statistics", result.name + ".compute_invocations", result.computeInvocations);
+            }
+        }
+    }
+
+    // Records this frame's staging ring copies into its upload command buffer. On a shared queue it is returned to be
+    // submitted ahead of the frame's draw commands in the same batch. On a dedicated transfer queue it is submitted
+    // there right away, and the returned graphics command buffer acquires the uploaded buffers after the frame waits
+    // on the semaphore added to waits. Returns no command buffers when nothing is pending.
+    std::vector<VkCommandBuffer> recordUploads(std::vector<SemaphoreWait>& waits) {
+        if (!uploadStressData.empty() &&
+            !stagingRing.upload(uploadStressData.data(), uploadStressData.size(), uploadStressBuffer, 0)) {
+            throw std::runtime_error("staging ring is full!");
+        }
+
+        if (!stagingRing.hasPending()) {
+            return {};
+        }
+
+        VkCommandBuffer commandBuffer = frameContexts[currentFrame].getTransferPool().allocate(device);
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording upload command buffer!");
+        }
+
+        VkDeviceSize uploadedBytes;
+        if (queueManager.hasDedicatedTransferQueue()) {
+            // Query pools cannot be reset on a transfer-only queue, so dedicated uploads are not timed on the GPU.
+            uploadedBytes = stagingRing.record(commandBuffer, currentFrame, queueManager.getTransferFamily(), queueManager.getGraphicsFamily());
+        } else {
+            uint32_t slot = framesInFlight + currentFrame;
+            gpuProfiler.resetSlot(commandBuffer, slot);
+            gpuProfiler.beginScope(commandBuffer, slot, "upload");
+            uploadedBytes = stagingRing.record(commandBuffer, currentFrame);
+            gpuProfiler.endScope(commandBuffer, slot);
+            uploadSlots[currentFrame] = gpuProfiler.isEnabled();
+        }
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
+
+        benchmark.record("upload", "bytes", uploadedBytes);
+        if (!queueManager.hasDedicatedTransferQueue()) {
+            return {commandBuffer};
+        }
+
+        std::vector<VkCommandBuffer> transferCommandBuffers = {commandBuffer};
+        queueManager.submitToTransferQueue(transferCommandBuffers, currentFrame);
+        waits.push_back(queueManager.getTransferCompleteWait(currentFrame));
+
+        VkCommandBuffer acquireCommandBuffer = frameContexts[currentFrame].getGraphicsPool().allocate(device);
+        if (vkBeginCommandBuffer(acquireCommandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording acquire command buffer!");
+        }
+        stagingRing.recordAcquire(acquireCommandBuffer, queueManager.getTransferFamily(), queueManager.getGraphicsFamily());
+        if (vkEndCommandBuffer(acquireCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record acquire command buffer!");
+        }
+        return {acquireCommandBuffer};
+    }
+
+    bool isCullingAsync() {
+        return options.gpuCull && queueManager.hasDedicatedComputeQueue();
+    }
+
+    // Instances are placed directly in clip space, so the frustum is the clip volume itself.
+    void recordCull(VkCommandBuffer commandBuffer, uint32_t cullFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t drawFamily = VK_QUEUE_FAMILY_IGNORED) {
+        gpuCuller.record(commandBuffer, currentFrame, Frustum::fromMatrix(glm::mat4(1.0f)), instanceBuffer.getCapacity(),
+                         mesh.getIndexCount(), mesh.getBoundingRadius(), cullFamily, drawFamily);
+    }
+
+    // With a dedicated compute queue the culling dispatch is submitted there, where it can overlap the graphics work
+    // of earlier frames, and the frame's draws wait for it at the indirect stage. Query pools are reset on the graphics
+    // queue, so culling on the compute queue is not timed on the GPU.
+    void submitCull(std::vector<SemaphoreWait>& waits) {
+        VkCommandBuffer commandBuffer = frameContexts[currentFrame].getComputePool().allocate(device);
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording culling command buffer!");
+        }
+        recordCull(commandBuffer, queueManager.getComputeFamily(), queueManager.getGraphicsFamily());
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record culling command buffer!");
+        }
+
+        std::vector<VkCommandBuffer> computeCommandBuffers = {commandBuffer};
+        queueManager.submitToComputeQueue(computeCommandBuffers, currentFrame);
+        waits.push_back(queueManager.getComputeCompleteWait(currentFrame, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT));
+    }
+
+    void recordCommandBufferCounters() {
+        CommandBufferCounters counters = frameContexts[currentFrame].getCounters();
+        benchmark.record("command_buffers", "allocated", counters.allocated);
+        benchmark.record("command_buffers", "reused", counters.reused);
+    }
+
+    void incrementFrameCount() { currentFrame = (currentFrame + 1) % framesInFlight; }
 
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
             VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -447,38 +1248,201 @@ private:
     }
 
     void mainLoop() {
-        while (!glfwWindowShouldClose(window)){
-            glfwPollEvents();
+        if (options.benchmarkFrames > 0) {
+            startBenchmark();
+        }
+
+        // A limit of zero renders until the window is closed.
+        uint32_t frameLimit = options.benchmarkFrames > 0 ? options.benchmarkFrames : (options.headless ? options.frameCount : 0);
+        uint32_t frame = 0;
+
+        framePacer.init(options.targetFps);
+        Stopwatch runTimer;
+        Stopwatch frameTimer;
+        for (; frameLimit == 0 || frame < frameLimit; frame++) {
+            if (!options.headless) {
+                if (glfwWindowShouldClose(window)) {
+                    break;
+                }
+                glfwPollEvents();
+            }
             drawFrame();
+            if (framePacer.isEnabled()) {
+                Stopwatch pacingTimer;
+                framePacer.wait();
+                benchmark.record("pacing", pacingTimer.lap());
+            }
+            benchmark.record("frame", frameTimer.lap());
         }
         vkDeviceWaitIdle(device);
+        double runTime = runTimer.lap();
+
+        if (benchmark.isEnabled()) {
+            finishBenchmark(frame, runTime);
+        }
+
+        if (options.headless && !options.outputImage.empty()) {
+            std::cout << "Writing " << options.outputImage << "..." << std::endl;
+            offscreenTarget.readback(deviceAllocator, device, commandPool, queueManager.getGraphicsQueue(), lastImageIndex, options.outputImage);
+        }
+    }
+
+    void startBenchmark() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        benchmark.enable();
+        benchmark.setInfo("mode", options.headless ? "headless" : "windowed");
+        benchmark.setInfo("device", properties.deviceName);
+        benchmark.setInfo("transfer_queue", queueManager.hasDedicatedTransferQueue() ? "dedicated" : "graphics");
+        benchmark.setInfo("compute_queue", queueManager.hasDedicatedComputeQueue() ? "dedicated" : "graphics");
+        benchmark.setInfo("sync_backend", queueManager.isTimelineEnabled() ? "timeline" : "binary");
+        if (options.cpuCull) {
+            benchmark.setInfo("culling", "cpu");
+        } else if (options.gpuCull) {
+            benchmark.setInfo("culling", gpuCuller.isUsingDrawCount() ? "gpu_indirect_count" : "gpu_indirect");
+        } else {
+            benchmark.setInfo("culling", "none");
+        }
+        benchmark.setInfo("descriptors", options.bindless ? "bindless" : "per_draw");
+        if (!options.headless) {
+            benchmark.setInfo("present_policy", presentPolicyName(presentPolicy));
+            benchmark.setInfo("present_mode", presentModeName(swapChain.getPresentConfig().presentMode));
+        }
+    }
+
+    void finishBenchmark(uint32_t frames, double runTime) {
+        benchmark.setMetric("frames", frames);
+        benchmark.setMetric("total_ms", runTime);
+        benchmark.setMetric("fps", runTime > 0.0 ? frames * 1000.0 / runTime : 0.0);
+        for (auto& compiled : pipelineCompiler.getCompileTimes()) {
+            benchmark.setMetric("pipeline_compile_ms." + compiled.name, compiled.compileMilliseconds);
+        }
+        benchmark.setMetric("frames_in_flight", framesInFlight);
+        benchmark.setMetric("shader_reloads", shaderReloads);
+        benchmark.setMetric("pipeline_variants.count", pipelineVariants.getSize());
+        benchmark.setMetric("pipeline_variants.hits", pipelineVariants.getHits());
+        benchmark.setMetric("pipeline_variants.misses", pipelineVariants.getMisses());
+        // Time the CPU spent blocked on the GPU, either on its own frame slot or on a swap chain image still in use.
+        double blockedTime = benchmark.sum("cpu_ms", "fence_wait") + benchmark.sum("cpu_ms", "image_wait");
+        benchmark.setMetric("sync.blocked_ms", blockedTime);
+        benchmark.setMetric("sync.blocked_fraction", runTime > 0.0 ? blockedTime / runTime : 0.0);
+        benchmark.setMetric("sync.image_waits", imageWaits);
+        benchmark.setMetric("target_fps", options.targetFps);
+        if (!options.headless) {
+            benchmark.setMetric("swapchain_images", swapChain.getSize());
+        }
+        benchmark.setMetric("record.draws_per_frame", options.drawCount);
+        benchmark.setMetric("record.instances_per_frame", instanceBuffer.getCapacity());
+        benchmark.setMetric("instances.bytes_per_frame", static_cast<double>(instanceBuffer.getFrameSize()));
+        benchmark.setMetric("record.threads", parallelRecorder.getThreadCount());
+        benchmark.setMetric("uniforms.bytes_per_frame", frames > 0 ? benchmark.sum("uniforms", "bytes") / frames : 0.0);
+        benchmark.setMetric("uniforms.capacity_per_frame", static_cast<double>(uniformRing.getFrameCapacity()));
+        benchmark.setMetric("bindless.handles", options.bindless ? bindlessTable.getLiveHandles() : 0);
+        RenderGraphStatistics graph = renderGraph.getStatistics();
+        benchmark.setMetric("render_graph.render_scale", options.renderScale);
+        benchmark.setMetric("render_graph.passes", graph.declaredPasses - graph.culledPasses);
+        benchmark.setMetric("render_graph.culled_passes", graph.culledPasses);
+        benchmark.setMetric("render_graph.barriers_per_frame", graph.barriersPerFrame);
+        benchmark.setMetric("render_graph.transient_images", graph.transientImages);
+        benchmark.setMetric("render_graph.transient_bytes", static_cast<double>(graph.transientBytes));
+        benchmark.setMetric("render_graph.allocated_bytes", static_cast<double>(graph.allocatedBytes));
+
+        double uploadedBytes = benchmark.sum("upload", "bytes");
+        double uploadCpuTime = benchmark.sum("cpu_ms", "upload");
+        double uploadGpuTime = benchmark.sum("gpu_ms", "upload");
+        benchmark.setMetric("upload.total_bytes", uploadedBytes);
+        benchmark.setMetric("upload.cpu_mb_per_s", uploadCpuTime > 0.0 ? uploadedBytes / (1024.0 * 1024.0) / (uploadCpuTime / 1000.0) : 0.0);
+        double culledObjects = benchmark.sum("cull", "objects");
+        double cullTime = benchmark.sum("cpu_ms", "cull");
+        benchmark.setMetric("cull.threads", options.cpuCull ? cpuCuller.getThreadCount() : 0);
+        benchmark.setMetric("cull.objects_per_second", cullTime > 0.0 ? culledObjects / (cullTime / 1000.0) : 0.0);
+        benchmark.setMetric("cull.visible_fraction", culledObjects > 0.0 ? benchmark.sum("cull", "visible") / culledObjects : 0.0);
+        benchmark.setMetric("upload.gpu_mb_per_s", uploadGpuTime > 0.0 ? uploadedBytes / (1024.0 * 1024.0) / (uploadGpuTime / 1000.0) : 0.0);
+
+        AllocatorStatistics memory = deviceAllocator.getStatistics();
+        benchmark.setMetric("memory.blocks", memory.blockCount);
+        benchmark.setMetric("memory.dedicated_allocations", memory.dedicatedAllocationCount);
+        benchmark.setMetric("memory.allocations", memory.allocationCount);
+        benchmark.setMetric("memory.device_memory_allocations", memory.deviceMemoryAllocations);
+        benchmark.setMetric("memory.reserved_bytes", memory.reservedBytes);
+        benchmark.setMetric("memory.used_bytes", memory.usedBytes);
+        benchmark.setMetric("memory.largest_free_range", memory.largestFreeRange);
+        benchmark.setMetric("memory.fragmentation", memory.fragmentation);
+
+        benchmark.write(options.benchmarkOutput);
     }
 
     void cleanup() {
+        shaderReloader.cleanup();
+        pipelineCompiler.cleanup();
+        assetLoader.cleanup();
         if (enableValidationLayers) {
             DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
         }
-        frameBuffer.cleanup(device);
-        swapChain.cleanup(device);
+        deletionQueue.flush();
+        renderGraph.cleanup(device, deviceAllocator);
+        if (options.headless) {
+            offscreenTarget.cleanup(deviceAllocator, device);
+        } else {
+            swapChain.cleanup(device);
+        }
         vkDestroyCommandPool(device, commandPool, nullptr);
+        parallelRecorder.cleanup();
+        for (auto& frame : frameContexts) {
+            frame.cleanup(device);
+        }
+        mesh.cleanup(deviceAllocator);
+        if (options.gpuCull) {
+            gpuCuller.cleanup(device, deviceAllocator);
+        }
+        cpuCuller.cleanup();
+        instanceBuffer.cleanup(deviceAllocator);
+        stagingRing.cleanup(deviceAllocator);
+        uniformRing.cleanup(device, deviceAllocator);
+        if (options.bindless) {
+            bindlessTable.cleanup(device);
+        }
+        if (uploadStressBuffer != VK_NULL_HANDLE) {
+            deviceAllocator.destroyBuffer(uploadStressBuffer, uploadStressAllocation);
+        }
+        pipelineVariants.cleanup(device);
         graphicsPipeline.cleanup(device);
+        pipelineCache.cleanup(device);
         queueManager.cleanup(device);
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        gpuProfiler.cleanup(device);
+        for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
             vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
         }
+        deviceAllocator.cleanup();
         vkDestroyDevice(device, nullptr);
-        vkDestroySurfaceKHR(instance, surface, nullptr);
+        if (!options.headless) {
+            vkDestroySurfaceKHR(instance, surface, nullptr);
+        }
         vkDestroyInstance(instance, nullptr);
-        glfwDestroyWindow(window);
-        glfwTerminate();
+        if (!options.headless) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        }
     }
 };
 
-int main() {
-    std::cout << "Running from: " << std::filesystem::current_path().string() << std::endl;
-    HelloTriangleApplication app;
-
+int main(int argc, char* argv[]) {
     try {
+        AppOptions options = parseOptions(argc, argv);
+        if (options.benchmarkOutput.empty() && (options.benchmarkFrames > 0 || options.cullBenchObjects > 0)) {
+            // The results go to stdout, so the log moves to stderr.
+            FrameBenchmark::reserveStdout();
+        }
+        std::cout << "Running from: " << std::filesystem::current_path().string() << std::endl;
+
+        if (options.cullBenchObjects > 0) {
+            // Needs no device; runs instead of the application.
+            uint32_t iterations = options.benchmarkFrames > 0 ? options.benchmarkFrames : 100;
+            runCullBenchmark(options.cullBenchObjects, iterations, ThreadPool::defaultThreadCount()).write(options.benchmarkOutput);
+            return EXIT_SUCCESS;
+        }
+        HelloTriangleApplication app(options);
         app.run();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
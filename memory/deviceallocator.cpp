@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "memoryutils.cpp"
+
+#ifndef DEVICE_ALLOCATOR
+#define DEVICE_ALLOCATOR
+    // Buffers and linear images never share a block with optimal-tiling images, so neighbouring sub-allocations can
+    // never violate bufferImageGranularity.
+    enum class AllocationKind {
+        Linear,
+        Optimal
+    };
+
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // A single VkDeviceMemory carved into sub-allocations. Free ranges are indexed by offset (for coalescing) and by
+    // size (for best-fit lookup), so both allocate and free are O(log n) in the number of free ranges.
+    class MemoryBlock {
+        std::map<VkDeviceSize, VkDeviceSize> freeByOffset;
+        std::multimap<VkDeviceSize, VkDeviceSize> freeBySize;
+
+    public:
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        VkDeviceSize used = 0;
+        uint32_t allocationCount = 0;
+        void* mapped = nullptr;
+
+        void init(VkDeviceMemory blockMemory, VkDeviceSize blockSize, void* blockMapped) {
+            memory = blockMemory;
+            size = blockSize;
+            mapped = blockMapped;
+            insertFreeRange(0, size);
+        }
+
+        bool allocate(VkDeviceSize allocationSize, VkDeviceSize alignment, VkDeviceSize& offset) {
+            for (auto it = freeBySize.lower_bound(allocationSize); it != freeBySize.end(); ++it) {
+                VkDeviceSize rangeOffset = it->second;
+                VkDeviceSize rangeEnd = rangeOffset + it->first;
+                VkDeviceSize alignedOffset = alignUp(rangeOffset, alignment);
+                if (alignedOffset + allocationSize > rangeEnd) {
+                    continue;
+                }
+
+                eraseFreeRange(rangeOffset, it->first);
+                if (alignedOffset > rangeOffset) {
+                    insertFreeRange(rangeOffset, alignedOffset - rangeOffset);
+                }
+                if (alignedOffset + allocationSize < rangeEnd) {
+                    insertFreeRange(alignedOffset + allocationSize, rangeEnd - alignedOffset - allocationSize);
+                }
+
+                offset = alignedOffset;
+                used += allocationSize;
+                allocationCount++;
+                return true;
+            }
+            return false;
+        }
+
+        void free(VkDeviceSize offset, VkDeviceSize allocationSize) {
+            used -= allocationSize;
+            allocationCount--;
+
+            VkDeviceSize rangeOffset = offset;
+            VkDeviceSize rangeSize = allocationSize;
+
+            auto next = freeByOffset.lower_bound(offset);
+            if (next != freeByOffset.end() && next->first == offset + allocationSize) {
+                rangeSize += next->second;
+                eraseFreeRange(next->first, next->second);
+            }
+
+            auto previous = freeByOffset.lower_bound(offset);
+            if (previous != freeByOffset.begin()) {
+                --previous;
+                if (previous->first + previous->second == offset) {
+                    rangeOffset = previous->first;
+                    rangeSize += previous->second;
+                    eraseFreeRange(previous->first, previous->second);
+                }
+            }
+
+            insertFreeRange(rangeOffset, rangeSize);
+        }
+
+        VkDeviceSize largestFreeRange() {
+            return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+        }
+
+        size_t freeRangeCount() {
+            return freeByOffset.size();
+        }
+
+    private:
+        void insertFreeRange(VkDeviceSize offset, VkDeviceSize rangeSize) {
+            freeByOffset[offset] = rangeSize;
+            freeBySize.emplace(rangeSize, offset);
+        }
+
+        void eraseFreeRange(VkDeviceSize offset, VkDeviceSize rangeSize) {
+            freeByOffset.erase(offset);
+            auto range = freeBySize.equal_range(rangeSize);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == offset) {
+                    freeBySize.erase(it);
+                    return;
+                }
+            }
+        }
+    };
+
+    struct Allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        // Host pointer to offset when the memory type is host visible, otherwise nullptr.
+        void* mapped = nullptr;
+        uint32_t memoryTypeIndex = 0;
+        // nullptr for dedicated allocations.
+        MemoryBlock* block = nullptr;
+    };
+
+    struct AllocatorStatistics {
+        uint32_t blockCount = 0;
+        uint32_t dedicatedAllocationCount = 0;
+        uint32_t allocationCount = 0;
+        uint32_t deviceMemoryAllocations = 0;
+        VkDeviceSize reservedBytes = 0;
+        VkDeviceSize usedBytes = 0;
+        VkDeviceSize freeBytes = 0;
+        VkDeviceSize largestFreeRange = 0;
+        size_t freeRangeCount = 0;
+        // 0 when all free space in the blocks is contiguous, approaching 1 as it splinters into small ranges.
+        double fragmentation = 0.0;
+    };
+
+    // Sub-allocates buffers and images out of large per-memory-type blocks instead of calling vkAllocateMemory per
+    // resource. Host visible blocks stay persistently mapped. Safe to call from several threads.
+    class DeviceAllocator {
+        struct Pool {
+            std::vector<std::unique_ptr<MemoryBlock>> blocks;
+        };
+
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkDevice device = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        VkDeviceSize preferredBlockSize = 0;
+        uint32_t maxAllocationCount = 0;
+
+        std::mutex mutex;
+        std::vector<Pool> pools;
+        uint32_t deviceMemoryAllocations = 0;
+        uint32_t dedicatedAllocationCount = 0;
+        VkDeviceSize dedicatedBytes = 0;
+
+    public:
+        void init(VkPhysicalDevice& physical, VkDevice& logical, VkDeviceSize blockSize = 64 * 1024 * 1024) {
+            std::cout << "Initializing device memory allocator..." << std::endl;
+            physicalDevice = physical;
+            device = logical;
+            preferredBlockSize = blockSize;
+
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+            maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+            vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+            pools.resize(memoryProperties.memoryTypeCount * 2);
+        }
+
+        Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationKind kind) {
+            uint32_t memoryTypeIndex = findMemoryType(physicalDevice, requirements.memoryTypeBits, properties);
+            VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            Allocation allocation;
+            allocation.memoryTypeIndex = memoryTypeIndex;
+            allocation.size = requirements.size;
+
+            // Large resources would mostly waste a shared block, so they get their own memory.
+            if (requirements.size > blockSize / 2) {
+                allocation.memory = allocateDeviceMemory(memoryTypeIndex, requirements.size, allocation.mapped);
+                dedicatedAllocationCount++;
+                dedicatedBytes += requirements.size;
+                return allocation;
+            }
+
+            Pool& pool = pools[memoryTypeIndex * 2 + static_cast<uint32_t>(kind)];
+            for (auto& block : pool.blocks) {
+                if (block->allocate(requirements.size, requirements.alignment, allocation.offset)) {
+                    return fromBlock(allocation, block.get());
+                }
+            }
+
+            auto block = std::make_unique<MemoryBlock>();
+            void* mapped = nullptr;
+            VkDeviceMemory memory = allocateDeviceMemory(memoryTypeIndex, blockSize, mapped);
+            block->init(memory, blockSize, mapped);
+            block->allocate(requirements.size, requirements.alignment, allocation.offset);
+            pool.blocks.push_back(std::move(block));
+            return fromBlock(allocation, pool.blocks.back().get());
+        }
+
+        void free(Allocation& allocation) {
+            if (allocation.memory == VK_NULL_HANDLE) {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (allocation.block == nullptr) {
+                freeDeviceMemory(allocation.memory, allocation.mapped != nullptr);
+                dedicatedAllocationCount--;
+                dedicatedBytes -= allocation.size;
+            } else {
+                allocation.block->free(allocation.offset, allocation.size);
+                releaseIfUnused(allocation.memoryTypeIndex, allocation.block);
+            }
+            allocation = Allocation();
+        }
+
+        Allocation createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer) {
+            VkBufferCreateInfo bufferInfo = {};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = size;
+            bufferInfo.usage = usage;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create buffer!");
+            }
+
+            VkMemoryRequirements requirements;
+            vkGetBufferMemoryRequirements(device, buffer, &requirements);
+
+            Allocation allocation = allocate(requirements, properties, AllocationKind::Linear);
+            vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+            return allocation;
+        }
+
+        Allocation createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image) {
+            if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create image!");
+            }
+
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(device, image, &requirements);
+
+            AllocationKind kind = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? AllocationKind::Optimal : AllocationKind::Linear;
+            Allocation allocation = allocate(requirements, properties, kind);
+            vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+            return allocation;
+        }
+
+        void destroyBuffer(VkBuffer& buffer, Allocation& allocation) {
+            vkDestroyBuffer(device, buffer, nullptr);
+            buffer = VK_NULL_HANDLE;
+            free(allocation);
+        }
+
+        void destroyImage(VkImage& image, Allocation& allocation) {
+            vkDestroyImage(device, image, nullptr);
+            image = VK_NULL_HANDLE;
+            free(allocation);
+        }
+
+        AllocatorStatistics getStatistics() {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            AllocatorStatistics statistics;
+            statistics.dedicatedAllocationCount = dedicatedAllocationCount;
+            statistics.allocationCount = dedicatedAllocationCount;
+            statistics.deviceMemoryAllocations = deviceMemoryAllocations;
+            statistics.reservedBytes = dedicatedBytes;
+            statistics.usedBytes = dedicatedBytes;
+
+            for (auto& pool : pools) {
+                for (auto& block : pool.blocks) {
+                    statistics.blockCount++;
+                    statistics.allocationCount += block->allocationCount;
+                    statistics.reservedBytes += block->size;
+                    statistics.usedBytes += block->used;
+                    statistics.freeBytes += block->size - block->used;
+                    statistics.freeRangeCount += block->freeRangeCount();
+                    statistics.largestFreeRange = std::max(statistics.largestFreeRange, block->largestFreeRange());
+                }
+            }
+
+            if (statistics.freeBytes > 0) {
+                statistics.fragmentation = 1.0 - static_cast<double>(statistics.largestFreeRange) / statistics.freeBytes;
+            }
+            return statistics;
+        }
+
+        void cleanup() {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& pool : pools) {
+                for (auto& block : pool.blocks) {
+                    if (block->allocationCount > 0) {
+                        std::cerr << "Device memory block destroyed with " << block->allocationCount << " live allocation(s)." << std::endl;
+                    }
+                    freeDeviceMemory(block->memory, block->mapped != nullptr);
+                }
+                pool.blocks.clear();
+            }
+            if (dedicatedAllocationCount > 0) {
+                std::cerr << dedicatedAllocationCount << " dedicated allocation(s) were not freed." << std::endl;
+            }
+        }
+
+    private:
+        VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) {
+            // Keep small heaps (e.g. 256 MiB host visible device local) from being swallowed by a few blocks.
+            VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+            return std::min(preferredBlockSize, heapSize / 8);
+        }
+
+        Allocation fromBlock(Allocation allocation, MemoryBlock* block) {
+            allocation.memory = block->memory;
+            allocation.block = block;
+            if (block->mapped != nullptr) {
+                allocation.mapped = static_cast<char*>(block->mapped) + allocation.offset;
+            }
+            return allocation;
+        }
+
+        VkDeviceMemory allocateDeviceMemory(uint32_t memoryTypeIndex, VkDeviceSize size, void*& mapped) {
+            if (deviceMemoryAllocations >= maxAllocationCount) {
+                throw std::runtime_error("exceeded maxMemoryAllocationCount!");
+            }
+
+            VkMemoryAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = size;
+            allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+            VkDeviceMemory memory;
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate device memory!");
+            }
+            deviceMemoryAllocations++;
+
+            mapped = nullptr;
+            if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+                vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+            }
+            return memory;
+        }
+
+        void freeDeviceMemory(VkDeviceMemory memory, bool mapped) {
+            if (mapped) {
+                vkUnmapMemory(device, memory);
+            }
+            vkFreeMemory(device, memory, nullptr);
+            deviceMemoryAllocations--;
+        }
+
+        // Keeps one empty block per pool around so a resource that is freed and recreated every frame does not hit
+        // vkAllocateMemory each time.
+        void releaseIfUnused(uint32_t memoryTypeIndex, MemoryBlock* block) {
+            if (block->allocationCount > 0) {
+                return;
+            }
+
+            for (uint32_t kind = 0; kind < 2; kind++) {
+                Pool& pool = pools[memoryTypeIndex * 2 + kind];
+                auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                                       [block](const std::unique_ptr<MemoryBlock>& candidate) { return candidate.get() == block; });
+                if (it == pool.blocks.end()) {
+                    continue;
+                }
+
+                size_t emptyBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+                                                   [](const std::unique_ptr<MemoryBlock>& candidate) { return candidate->allocationCount == 0; });
+                if (emptyBlocks > 1) {
+                    freeDeviceMemory(block->memory, block->mapped != nullptr);
+                    pool.blocks.erase(it);
+                }
+                return;
+            }
+        }
+    };
+#endif
@@ -0,0 +1,71 @@
+#include <algorithm>
+#include "deviceallocator.cpp"
+
+#ifndef LINEAR_ALLOCATOR
+#define LINEAR_ALLOCATOR
+    struct LinearSlice {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+    };
+
+    // Bump allocator over one persistently mapped buffer for data that only lives for a single frame. Nothing is
+    // freed individually; the owner calls reset() once the GPU is done with everything handed out since the last reset.
+    class LinearAllocator {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Allocation allocation;
+        VkDeviceSize capacity = 0;
+        VkDeviceSize head = 0;
+        VkDeviceSize peak = 0;
+
+    public:
+        void init(DeviceAllocator& allocator, VkDeviceSize size, VkBufferUsageFlags usage,
+                  VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+            capacity = size;
+            allocation = allocator.createBuffer(size, usage, properties, buffer);
+        }
+
+        // Returns a slice with a null mapped pointer and zero size when the allocator is full.
+        LinearSlice allocate(VkDeviceSize size, VkDeviceSize alignment) {
+            VkDeviceSize offset = alignUp(head, alignment);
+            if (offset + size > capacity) {
+                return LinearSlice();
+            }
+
+            head = offset + size;
+            peak = std::max(peak, head);
+
+            LinearSlice slice;
+            slice.buffer = buffer;
+            slice.offset = offset;
+            slice.size = size;
+            slice.mapped = allocation.mapped != nullptr ? static_cast<char*>(allocation.mapped) + offset : nullptr;
+            return slice;
+        }
+
+        void reset() {
+            head = 0;
+        }
+
+        VkBuffer& getBuffer() {
+            return buffer;
+        }
+
+        VkDeviceSize getUsed() {
+            return head;
+        }
+
+        VkDeviceSize getPeak() {
+            return peak;
+        }
+
+        VkDeviceSize getCapacity() {
+            return capacity;
+        }
+
+        void cleanup(DeviceAllocator& allocator) {
+            allocator.destroyBuffer(buffer, allocation);
+        }
+    };
+#endif
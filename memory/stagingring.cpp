@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include "deviceallocator.cpp"
+
+#ifndef STAGING_RING
+#define STAGING_RING
+    // Persistently mapped upload buffer used as a ring. upload() copies into the ring and queues a buffer copy; all
+    // queued copies are recorded into one command buffer per frame with record(). The space written in a frame is
+    // reclaimed by releaseFrame() once that frame's fence has signaled.
+    class StagingRing {
+        struct PendingCopy {
+            VkBuffer destination;
+            VkBufferCopy region;
+        };
+
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Allocation allocation;
+        VkDeviceSize capacity = 0;
+
+        // Monotonic byte positions; the ring offset is position % capacity.
+        uint64_t head = 0;
+        uint64_t tail = 0;
+        std::vector<uint64_t> frameEnds;
+
+        std::vector<PendingCopy> pending;
+        VkDeviceSize pendingBytes = 0;
+        std::vector<VkBuffer> released;
+
+    public:
+        void init(DeviceAllocator& allocator, VkDeviceSize size, uint32_t framesInFlight) {
+            std::cout << "Initializing staging ring (" << size / 1024 << " KiB)..." << std::endl;
+            capacity = size;
+            frameEnds.assign(framesInFlight, 0);
+            allocation = allocator.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer);
+        }
+
+        // Returns false if the ring has no room until more frames complete.
+        bool upload(const void* data, VkDeviceSize size, VkBuffer destination, VkDeviceSize destinationOffset) {
+            if (size > capacity) {
+                throw std::runtime_error("upload is larger than the staging ring!");
+            }
+
+            uint64_t start = alignUp(head, 16);
+            VkDeviceSize offset = start % capacity;
+            if (offset + size > capacity) {
+                // Never split a copy across the end of the ring.
+                start += capacity - offset;
+                offset = 0;
+            }
+            if (start + size - tail > capacity) {
+                return false;
+            }
+
+            std::memcpy(static_cast<char*>(allocation.mapped) + offset, data, size);
+
+            PendingCopy copy;
+            copy.destination = destination;
+            copy.region.srcOffset = offset;
+            copy.region.dstOffset = destinationOffset;
+            copy.region.size = size;
+            pending.push_back(copy);
+
+            pendingBytes += size;
+            head = start + size;
+            return true;
+        }
+
+        bool hasPending() {
+            return !pending.empty();
+        }
+
+        // Records every queued copy, one vkCmdCopyBuffer per destination buffer, followed by a barrier that makes the
+        // data visible to any later read. Returns the number of bytes copied.
+        //
+        // When the command buffer runs on a different queue family than the one reading the data, the barrier instead
+        // releases ownership of every destination buffer to readFamily; recordAcquire() must then be recorded on that
+        // family after waiting on the upload submission. Earlier contents of the destinations are not transferred
+        // back, so uploads must only target buffers (or ranges) that no frame still in flight reads.
+        VkDeviceSize record(VkCommandBuffer commandBuffer, uint32_t frameIndex,
+                            uint32_t uploadFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t readFamily = VK_QUEUE_FAMILY_IGNORED) {
+            std::stable_sort(pending.begin(), pending.end(), [](const PendingCopy& a, const PendingCopy& b) {
+                return std::less<VkBuffer>()(a.destination, b.destination);
+            });
+
+            std::vector<VkBuffer> destinations;
+            std::vector<VkBufferCopy> regions;
+            for (size_t i = 0; i < pending.size(); i++) {
+                regions.push_back(pending[i].region);
+                if (i + 1 == pending.size() || pending[i + 1].destination != pending[i].destination) {
+                    vkCmdCopyBuffer(commandBuffer, buffer, pending[i].destination, static_cast<uint32_t>(regions.size()), regions.data());
+                    destinations.push_back(pending[i].destination);
+                    regions.clear();
+                }
+            }
+
+            if (uploadFamily == readFamily) {
+                VkMemoryBarrier barrier = {};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = readAccess;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages,
+                                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+            } else {
+                // Release half of the ownership transfer; the destination access and stages are ignored here.
+                std::vector<VkBufferMemoryBarrier> barriers = buildOwnershipBarriers(destinations, uploadFamily, readFamily,
+                                                                                     VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                     0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+                released.insert(released.end(), destinations.begin(), destinations.end());
+            }
+
+            VkDeviceSize recordedBytes = pendingBytes;
+            frameEnds[frameIndex] = head;
+            pending.clear();
+            pendingBytes = 0;
+            return recordedBytes;
+        }
+
+        // Acquire half of the ownership transfer for everything released by record(). The submission containing it must
+        // wait on the upload submission at VK_PIPELINE_STAGE_TRANSFER_BIT. Returns false if nothing was released.
+        bool recordAcquire(VkCommandBuffer commandBuffer, uint32_t uploadFamily, uint32_t readFamily) {
+            if (released.empty()) {
+                return false;
+            }
+
+            std::vector<VkBufferMemoryBarrier> barriers = buildOwnershipBarriers(released, uploadFamily, readFamily, 0, readAccess);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages,
+                                 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+            released.clear();
+            return true;
+        }
+
+        // Frames complete in submission order, so everything up to the end of this frame's uploads is free again.
+        void releaseFrame(uint32_t frameIndex) {
+            tail = std::max(tail, frameEnds[frameIndex]);
+        }
+
+        VkDeviceSize getCapacity() {
+            return capacity;
+        }
+
+        void cleanup(DeviceAllocator& allocator) {
+            allocator.destroyBuffer(buffer, allocation);
+        }
+
+    private:
+        static const VkAccessFlags readAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                                VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                                                VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        static const VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                                       VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+        static std::vector<VkBufferMemoryBarrier> buildOwnershipBarriers(const std::vector<VkBuffer>& buffers, uint32_t srcFamily,
+                                                                         uint32_t dstFamily, VkAccessFlags srcAccess, VkAccessFlags dstAccess) {
+            std::vector<VkBufferMemoryBarrier> barriers;
+            for (VkBuffer destination : buffers) {
+                VkBufferMemoryBarrier barrier = {};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = dstAccess;
+                barrier.srcQueueFamilyIndex = srcFamily;
+                barrier.dstQueueFamilyIndex = dstFamily;
+                barrier.buffer = destination;
+                barrier.offset = 0;
+                barrier.size = VK_WHOLE_SIZE;
+                barriers.push_back(barrier);
+            }
+            return barriers;
+        }
+    };
+#endif
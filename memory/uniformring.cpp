@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "linearallocator.cpp"
+
+#ifndef UNIFORM_RING
+#define UNIFORM_RING
+    // Uniform data written by the CPU every frame, e.g. per-draw transforms. Each frame in flight owns a persistently
+    // mapped LinearAllocator, and every allocation is one block of the same size, aligned to
+    // minUniformBufferOffsetAlignment. A frame's buffer is bound through a single VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+    // descriptor covering one block, and each draw selects its block with a dynamic offset. Per-draw data then costs a
+    // pointer bump and an offset at bind time instead of a descriptor update or a buffer allocation.
+    //
+    // The descriptor range is always a whole block, so blocks are handed out at full size even when less is used.
+    class UniformRing {
+        std::vector<LinearAllocator> frames;
+        VkDeviceSize blockSize = 0;
+        VkDeviceSize alignment = 0;
+
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSet> descriptorSets;
+
+    public:
+        // Room for blocksPerFrame blocks of at least blockBytes each, visible to stages.
+        void init(VkPhysicalDevice& physicalDevice, VkDevice& device, DeviceAllocator& allocator, uint32_t framesInFlight,
+                  VkDeviceSize blockBytes, uint32_t blocksPerFrame, VkShaderStageFlags stages) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+            alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+            blockSize = alignUp(blockBytes, alignment);
+            if (blockSize > properties.limits.maxUniformBufferRange) {
+                throw std::runtime_error("uniform block exceeds maxUniformBufferRange!");
+            }
+            std::cout << "Initializing uniform ring (" << blocksPerFrame << " blocks of " << blockSize << " bytes per frame)..." << std::endl;
+
+            frames.resize(framesInFlight);
+            for (auto& frame : frames) {
+                frame.init(allocator, blockSize * blocksPerFrame, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+            }
+            createDescriptors(device, framesInFlight, stages);
+        }
+
+        // Makes the whole frame available again; only once the GPU is done with the frame's previous submission.
+        void resetFrame(size_t frame) {
+            frames[frame].reset();
+        }
+
+        // A block of the frame's buffer and the dynamic offset to bind it with. Host coherent, so nothing needs
+        // flushing before submission.
+        void* allocate(size_t frame, uint32_t& dynamicOffset) {
+            LinearSlice slice = frames[frame].allocate(blockSize, alignment);
+            if (slice.mapped == nullptr) {
+                throw std::runtime_error("uniform ring is full!");
+            }
+            dynamicOffset = static_cast<uint32_t>(slice.offset);
+            return slice.mapped;
+        }
+
+        template<typename T>
+        T* push(size_t frame, uint32_t& dynamicOffset) {
+            if (sizeof(T) > blockSize) {
+                throw std::runtime_error("uniform data does not fit a block!");
+            }
+            return static_cast<T*>(allocate(frame, dynamicOffset));
+        }
+
+        void bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout, uint32_t set, size_t frame, uint32_t dynamicOffset) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, set, 1, &descriptorSets[frame], 1, &dynamicOffset);
+        }
+
+        VkDescriptorSetLayout getSetLayout() {
+            return setLayout;
+        }
+
+        // Bytes handed out for the frame since its last reset, alignment padding included.
+        VkDeviceSize getUsed(size_t frame) {
+            return frames[frame].getUsed();
+        }
+
+        VkDeviceSize getFrameCapacity() {
+            return frames.empty() ? 0 : frames[0].getCapacity();
+        }
+
+        void cleanup(VkDevice& device, DeviceAllocator& allocator) {
+            vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+            vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+            for (auto& frame : frames) {
+                frame.cleanup(allocator);
+            }
+            frames.clear();
+            descriptorSets.clear();
+        }
+
+    private:
+        // One set per frame in flight, each with binding 0 over the first block of that frame's buffer.
+        void createDescriptors(VkDevice& device, uint32_t framesInFlight, VkShaderStageFlags stages) {
+            VkDescriptorSetLayoutBinding binding = {};
+            binding.binding = 0;
+            binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            binding.descriptorCount = 1;
+            binding.stageFlags = stages;
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.bindingCount = 1;
+            layoutInfo.pBindings = &binding;
+            if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create uniform descriptor set layout!");
+            }
+
+            VkDescriptorPoolSize poolSize = {};
+            poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            poolSize.descriptorCount = framesInFlight;
+
+            VkDescriptorPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.maxSets = framesInFlight;
+            poolInfo.poolSizeCount = 1;
+            poolInfo.pPoolSizes = &poolSize;
+            if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create uniform descriptor pool!");
+            }
+
+            std::vector<VkDescriptorSetLayout> layouts(framesInFlight, setLayout);
+            VkDescriptorSetAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = descriptorPool;
+            allocInfo.descriptorSetCount = framesInFlight;
+            allocInfo.pSetLayouts = layouts.data();
+            descriptorSets.resize(framesInFlight);
+            if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate uniform descriptor sets!");
+            }
+
+            for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+                VkDescriptorBufferInfo bufferInfo = {};
+                bufferInfo.buffer = frames[frame].getBuffer();
+                bufferInfo.offset = 0;
+                bufferInfo.range = blockSize;
+
+                VkWriteDescriptorSet write = {};
+                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.dstSet = descriptorSets[frame];
+                write.dstBinding = 0;
+                write.descriptorCount = 1;
+                write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+                write.pBufferInfo = &bufferInfo;
+                vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+            }
+        }
+    };
+#endif
@@ -1,185 +1,378 @@
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
-#include "fileutils.cpp"
+#include <glm/glm.hpp>
+#include "shadercode.cpp"
+#include "vertex.cpp"
+#include "instance.cpp"
+
+#ifndef GRAPHICS_PIPELINE
+#define GRAPHICS_PIPELINE
+// Matches the DrawUniforms block of shader.vert, one per draw in the uniform ring.
+struct DrawUniforms {
+    glm::mat4 transform;
+};
+
+// Matches the push constant block of bindless.vert: bindless table handles for the draw.
+struct DrawPushConstants {
+    uint32_t instanceBuffer;
+};
+
+// A 32-bit specialization constant, applied to every stage that declares constant_id = id. Bools are VkBool32 and
+// floats are stored by their bits.
+struct SpecializationConstant {
+    uint32_t id;
+    uint32_t value;
+};
+
+// Everything needed to build a VkPipeline, so creation can happen away from the object that owns the render pass
+// and layout (e.g. on a PipelineCompiler worker). Descriptions that compare equal build the same pipeline, which
+// makes them usable as keys of a PipelineVariantCache; the name is only a label and takes no part in that.
+struct GraphicsPipelineDescription {
+    std::string name;
+    ShaderCode vertShader;
+    ShaderCode fragShader;
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+    // Standard alpha blending when enabled.
+    bool blendEnable = false;
+    // Kept sorted by id, so equal sets of constants compare and hash equal.
+    std::vector<SpecializationConstant> specialization;
+    VkRenderPass renderPass;
+    VkPipelineLayout layout;
+    uint32_t subpass = 0;
+
+    void setConstant(uint32_t id, uint32_t value){
+        auto position = std::lower_bound(specialization.begin(), specialization.end(), id,
+                                         [](const SpecializationConstant& constant, uint32_t constantId) { return constant.id < constantId; });
+        if (position != specialization.end() && position->id == id) {
+            position->value = value;
+        } else {
+            specialization.insert(position, {id, value});
+        }
+    }
+
+    void setConstant(uint32_t id, float value){
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        setConstant(id, bits);
+    }
+
+    // Shaders are compared by size and content hash rather than by their words, which may no longer be mapped.
+    bool operator==(const GraphicsPipelineDescription& other) const {
+        auto sameBinding = [](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b) {
+            return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+        };
+        auto sameAttribute = [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) {
+            return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+        };
+        auto sameConstant = [](const SpecializationConstant& a, const SpecializationConstant& b) {
+            return a.id == b.id && a.value == b.value;
+        };
+        return vertShader.size == other.vertShader.size && vertShader.hash == other.vertShader.hash &&
+               fragShader.size == other.fragShader.size && fragShader.hash == other.fragShader.hash &&
+               std::equal(vertexBindings.begin(), vertexBindings.end(), other.vertexBindings.begin(), other.vertexBindings.end(), sameBinding) &&
+               std::equal(vertexAttributes.begin(), vertexAttributes.end(), other.vertexAttributes.begin(), other.vertexAttributes.end(), sameAttribute) &&
+               topology == other.topology && polygonMode == other.polygonMode && cullMode == other.cullMode &&
+               frontFace == other.frontFace && blendEnable == other.blendEnable &&
+               std::equal(specialization.begin(), specialization.end(), other.specialization.begin(), other.specialization.end(), sameConstant) &&
+               renderPass == other.renderPass && layout == other.layout && subpass == other.subpass;
+    }
+
+    size_t hash() const {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto mix = [&hash](uint64_t value) {
+            hash = (hash ^ value) * 0x100000001b3ull;
+        };
+        mix(vertShader.hash);
+        mix(fragShader.hash);
+        for (const auto& binding : vertexBindings) {
+            mix(binding.binding);
+            mix(binding.stride);
+            mix(binding.inputRate);
+        }
+        for (const auto& attribute : vertexAttributes) {
+            mix(attribute.location);
+            mix(attribute.binding);
+            mix(attribute.format);
+            mix(attribute.offset);
+        }
+        mix(topology);
+        mix(polygonMode);
+        mix(cullMode);
+        mix(frontFace);
+        mix(blendEnable);
+        for (const auto& constant : specialization) {
+            mix(constant.id);
+            mix(constant.value);
+        }
+        mix(reinterpret_cast<uint64_t>(renderPass));
+        mix(reinterpret_cast<uint64_t>(layout));
+        mix(subpass);
+        return static_cast<size_t>(hash);
+    }
+};
+
+VkShaderModule createShaderModule(VkDevice device, const ShaderCode& code){
+    VkShaderModuleCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size;
+    createInfo.pCode = code.words;
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    return shaderModule;
+}
+
+// Viewport, scissor and line width are set while recording (see setDynamicState()), so pipelines do not depend on
+// the size of what they render to and survive swap chain resizes.
+const VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+        VK_DYNAMIC_STATE_LINE_WIDTH
+};
+
+// Sets every state in dynamicStates to cover extent. Dynamic state is not inherited, so every command buffer that
+// draws, secondaries included, needs this after binding a pipeline.
+void setDynamicState(VkCommandBuffer commandBuffer, VkExtent2D extent){
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float) extent.width;
+    viewport.height = (float) extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.offset = {0, 0};
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    vkCmdSetLineWidth(commandBuffer, 1.0f);
+}
+
+VkPipeline createGraphicsPipeline(VkDevice device, const GraphicsPipelineDescription& description, VkPipelineCache pipelineCache){
+    // Vulkan Pipeline Spec: http://vulkan-spec-chunked.ahcox.com/ch09.html
+    VkShaderModule vertShaderModule = createShaderModule(device, description.vertShader);
+    VkShaderModule fragShaderModule;
+    try {
+        fragShaderModule = createShaderModule(device, description.fragShader);
+    } catch (const std::exception&) {
+        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        throw;
+    }
+
+    // Entries for constants a stage does not declare are ignored, so both stages share one map.
+    std::vector<VkSpecializationMapEntry> specializationEntries;
+    std::vector<uint32_t> specializationData;
+    for (const auto& constant : description.specialization) {
+        VkSpecializationMapEntry entry = {};
+        entry.constantID = constant.id;
+        entry.offset = static_cast<uint32_t>(specializationData.size() * sizeof(uint32_t));
+        entry.size = sizeof(uint32_t);
+        specializationEntries.push_back(entry);
+        specializationData.push_back(constant.value);
+    }
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+    specializationInfo.pMapEntries = specializationEntries.data();
+    specializationInfo.dataSize = specializationData.size() * sizeof(uint32_t);
+    specializationInfo.pData = specializationData.data();
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+    vertShaderStageInfo.pSpecializationInfo = specializationEntries.empty() ? nullptr : &specializationInfo;
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = specializationEntries.empty() ? nullptr : &specializationInfo;
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(description.vertexBindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = description.vertexBindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(description.vertexAttributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = description.vertexAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = description.topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // The viewport and scissor themselves are dynamic; only their count is part of the pipeline.
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = description.polygonMode;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = description.cullMode;
+    rasterizer.frontFace = description.frontFace;
+    rasterizer.depthBiasEnable = VK_FALSE;
+    rasterizer.depthBiasConstantFactor = 0.0f; // Optional
+    rasterizer.depthBiasClamp = 0.0f; // Optional
+    rasterizer.depthBiasSlopeFactor = 0.0f; // Optional
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading = 1.0f; // Optional
+    multisampling.pSampleMask = nullptr; // Optional
+    multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
+    multisampling.alphaToOneEnable = VK_FALSE; // Optional
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = description.blendEnable ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = description.blendEnable ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstColorBlendFactor = description.blendEnable ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+    colorBlending.blendConstants[0] = 0.0f; // Optional
+    colorBlending.blendConstants[1] = 0.0f; // Optional
+    colorBlending.blendConstants[2] = 0.0f; // Optional
+    colorBlending.blendConstants[3] = 0.0f; // Optional
+
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(sizeof(dynamicStates) / sizeof(dynamicStates[0]));
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipeline pipeline;
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = nullptr; // Optional
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = description.layout;
+    pipelineInfo.renderPass = description.renderPass;
+    pipelineInfo.subpass = description.subpass;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
+    pipelineInfo.basePipelineIndex = -1; // Optional
+
+    // The modules are only needed while the pipeline is created, and shader reloading survives a failure here.
+    VkResult result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    return pipeline;
+}
 
 class GraphicsPipeline{
-    VkPipeline graphicsPipeline;
+    VkPipeline graphicsPipeline = VK_NULL_HANDLE;
     VkPipelineLayout pipelineLayout;
-    RenderPass renderPass;
+    // Owned by the render graph.
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    // The code describe() builds from; replaced by shader hot reloading.
+    ShaderCode vertShader = shaders::triangleVert;
+    ShaderCode fragShader = shaders::triangleFrag;
 
 public:
-    void init(VkDevice &device, VkExtent2D& extent, VkFormat& imageFormat){
-        std::cout << "Initializing graphics pipeline..." << std::endl;
-        // Vulkan Pipeline Spec: http://vulkan-spec-chunked.ahcox.com/ch09.html
-        renderPass.init(device, imageFormat);
-
-        auto vertShaderCode = readFile("shaders/vert.spv");
-        auto fragShaderCode = readFile("shaders/frag.spv");
-
-        VkShaderModule vertShaderModule = createShaderModule(device, vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(device, fragShaderCode);
-
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 0;
-        vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-        vertexInputInfo.vertexAttributeDescriptionCount = 0;
-        vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
-
-        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; // TODO: Read into options here: https://vulkan.lunarg.com/doc/view/1.0.33.0/linux/vkspec.chunked/ch19s01.html
-        inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-        VkViewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float) extent.width;
-        viewport.height = (float) extent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor = {};
-        scissor.offset = {0, 0};
-        scissor.extent = extent;
-
-        VkPipelineViewportStateCreateInfo viewportState = {};
-        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
-        viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
-
-        VkPipelineRasterizationStateCreateInfo rasterizer = {};
-        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        rasterizer.depthBiasEnable = VK_FALSE;
-        rasterizer.depthBiasConstantFactor = 0.0f; // Optional
-        rasterizer.depthBiasClamp = 0.0f; // Optional
-        rasterizer.depthBiasSlopeFactor = 0.0f; // Optional
-
-        VkPipelineMultisampleStateCreateInfo multisampling = {};
-        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-        multisampling.minSampleShading = 1.0f; // Optional
-        multisampling.pSampleMask = nullptr; // Optional
-        multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
-        multisampling.alphaToOneEnable = VK_FALSE; // Optional
-
-        VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
-        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
-        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
-
-        VkPipelineColorBlendStateCreateInfo colorBlending = {};
-        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
-        colorBlending.blendConstants[0] = 0.0f; // Optional
-        colorBlending.blendConstants[1] = 0.0f; // Optional
-        colorBlending.blendConstants[2] = 0.0f; // Optional
-        colorBlending.blendConstants[3] = 0.0f; // Optional
-
-        VkDynamicState dynamicStates[] = {
-                VK_DYNAMIC_STATE_VIEWPORT,
-                VK_DYNAMIC_STATE_LINE_WIDTH
-        };
+    // constant_id of the output alpha in shader.frag; only visible with blendEnable.
+    static constexpr uint32_t alphaConstant = 0;
 
-//        VkPipelineDynamicStateCreateInfo dynamicState = {};
-//        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-//        dynamicState.dynamicStateCount = 2;
-//        dynamicState.pDynamicStates = dynamicStates;
+    // Creates the pipeline layout for drawing in renderPass. The pipeline itself is built from describe() and handed
+    // back through setPipeline(). Set 0 is the uniform ring's DrawUniforms and set 1, when given, the bindless table;
+    // DrawPushConstants are always available to the vertex stage.
+    void init(VkDevice &device, VkRenderPass pass, const std::vector<VkDescriptorSetLayout>& setLayouts){
+        std::cout << "Initializing graphics pipeline..." << std::endl;
+        renderPass = pass;
 
         VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0; // Optional
-        pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
-        pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-        pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+
+        VkPushConstantRange pushConstantRange = {};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DrawPushConstants);
+
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
         if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
+    }
 
-        VkGraphicsPipelineCreateInfo pipelineInfo = {};
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &inputAssembly;
-        pipelineInfo.pViewportState = &viewportState;
-        pipelineInfo.pRasterizationState = &rasterizer;
-        pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pDepthStencilState = nullptr; // Optional
-        pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = nullptr; // Optional
-        pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = renderPass.getRenderPass();
-        pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
-        pipelineInfo.basePipelineIndex = -1; // Optional
-
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create graphics pipeline!");
-        }
+    GraphicsPipelineDescription describe(){
+        GraphicsPipelineDescription description;
+        description.name = "triangle";
+        description.vertShader = vertShader;
+        description.fragShader = fragShader;
+        auto attributes = Vertex::getAttributeDescriptions();
+        auto instanceAttributes = Instance::getAttributeDescriptions();
+        description.vertexBindings = {Vertex::getBindingDescription(), Instance::getBindingDescription()};
+        description.vertexAttributes.assign(attributes.begin(), attributes.end());
+        description.vertexAttributes.insert(description.vertexAttributes.end(), instanceAttributes.begin(), instanceAttributes.end());
+        description.renderPass = renderPass;
+        description.layout = pipelineLayout;
+        return description;
+    }
 
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    void setPipeline(VkPipeline pipeline){
+        graphicsPipeline = pipeline;
+    }
+
+    // The code must stay valid for as long as it is set, since later describe() calls refer to it.
+    void setShaders(const ShaderCode& vert, const ShaderCode& frag){
+        vertShader = vert;
+        fragShader = frag;
     }
 
     VkPipeline& getPipeline(){
         return graphicsPipeline;
     }
 
-    VkRenderPass& getRenderPass(){
-        // TODO: this feels odd
-        return renderPass.getRenderPass();
+    VkPipelineLayout& getLayout(){
+        return pipelineLayout;
     }
 
+    // The pipeline itself belongs to the PipelineVariantCache it came from.
     void cleanup(VkDevice& device){
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-        vkDestroyRenderPass(device, renderPass.getRenderPass(), nullptr);
-    }
-
-private:
-    VkShaderModule createShaderModule(VkDevice& device, const std::vector<char>& code){
-        VkShaderModuleCreateInfo createInfo = {};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-        VkShaderModule shaderModule;
-        if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create shader module!");
-        }
-
-        return shaderModule;
     }
-};
\ No newline at end of file
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "assetloader.cpp"
+
+#ifndef PIPELINE_CACHE
+#define PIPELINE_CACHE
+    // Prefixed to the driver's cache data on disk. Vulkan's own header does not carry the driver version, and a
+    // checksum lets us reject truncated or corrupted files before handing them to the driver.
+    struct PipelineCacheFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t checksum;
+    };
+
+    class PipelineCache {
+        static const uint32_t fileMagic = 0x50434b56; // "VKCP"
+        static const uint32_t fileVersion = 1;
+
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties properties;
+        std::string path;
+        std::shared_future<MappedAsset> pendingFile;
+
+    public:
+        // Starts mapping and reading the cache file on loader's workers, so the disk read overlaps instance and device
+        // creation instead of stalling init().
+        void prefetch(AssetLoader& loader, const std::string& cachePath){
+            if (!cachePath.empty() && std::filesystem::exists(cachePath)) {
+                pendingFile = loader.prefetch(cachePath);
+            }
+        }
+
+        void init(VkPhysicalDevice& physicalDevice, VkDevice& device, const std::string& cachePath){
+            std::cout << "Initializing pipeline cache..." << std::endl;
+            path = cachePath;
+            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+            // The driver reads its data straight from the mapping, which only has to outlive vkCreatePipelineCache.
+            MappedAsset file;
+            ConstSpan<char> initialData = loadCacheData(file);
+
+            VkPipelineCacheCreateInfo createInfo = {};
+            createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+            createInfo.initialDataSize = initialData.size;
+            createInfo.pInitialData = initialData.data;
+
+            if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline cache!");
+            }
+        }
+
+        VkPipelineCache& getCache(){
+            return pipelineCache;
+        }
+
+        // Writes to a temporary file first and renames it over the old cache, so a crash mid-write never leaves a
+        // partial cache behind.
+        void save(VkDevice& device){
+            if (path.empty()) {
+                return;
+            }
+
+            size_t dataSize = 0;
+            vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr);
+            std::vector<char> data(dataSize);
+            if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+                std::cerr << "Failed to retrieve pipeline cache data, not saving." << std::endl;
+                return;
+            }
+            data.resize(dataSize);
+
+            PipelineCacheFileHeader header = buildHeader();
+            header.dataSize = data.size();
+            header.checksum = checksum({data.data(), data.size()});
+
+            std::string temporaryPath = path + ".tmp";
+            {
+                std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+                if (!file.is_open()) {
+                    std::cerr << "Failed to open " << temporaryPath << ", not saving pipeline cache." << std::endl;
+                    return;
+                }
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(data.data(), data.size());
+                if (!file.good()) {
+                    std::cerr << "Failed to write " << temporaryPath << ", not saving pipeline cache." << std::endl;
+                    return;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename(temporaryPath, path, error);
+            if (error) {
+                std::cerr << "Failed to replace " << path << ": " << error.message() << std::endl;
+                std::filesystem::remove(temporaryPath, error);
+                return;
+            }
+            std::cout << "Saved " << data.size() << " bytes of pipeline cache to " << path << std::endl;
+        }
+
+        void cleanup(VkDevice& device){
+            save(device);
+            vkDestroyPipelineCache(device, pipelineCache, nullptr);
+        }
+
+    private:
+        // Maps the cache file into file, or takes the prefetched mapping, and returns its driver data if it was
+        // written for this exact device and driver, or nothing. The data points into the mapping and is neither copied
+        // nor valid past file.
+        ConstSpan<char> loadCacheData(MappedAsset& file){
+            if (pendingFile.valid()) {
+                file = pendingFile.get();
+                pendingFile = std::shared_future<MappedAsset>();
+            } else if (!path.empty() && std::filesystem::exists(path)) {
+                file = AssetLoader::load(path);
+            } else {
+                return {};
+            }
+
+            PipelineCacheFileHeader header;
+            if (file->size() < sizeof(header)) {
+                std::cout << "Ignoring truncated pipeline cache " << path << std::endl;
+                return {};
+            }
+            std::memcpy(&header, file->data(), sizeof(header));
+
+            PipelineCacheFileHeader expected = buildHeader();
+            if (header.magic != expected.magic || header.version != expected.version ||
+                header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+                header.driverVersion != expected.driverVersion ||
+                std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+                std::cout << "Ignoring pipeline cache " << path << " written for a different device or driver." << std::endl;
+                return {};
+            }
+
+            ConstSpan<char> data = {file->data() + sizeof(header), file->size() - sizeof(header)};
+            if (header.dataSize != data.size || header.checksum != checksum(data)) {
+                std::cout << "Ignoring corrupted pipeline cache " << path << std::endl;
+                return {};
+            }
+
+            std::cout << "Loaded " << data.size << " bytes of pipeline cache from " << path << std::endl;
+            return data;
+        }
+
+        PipelineCacheFileHeader buildHeader(){
+            PipelineCacheFileHeader header = {};
+            header.magic = fileMagic;
+            header.version = fileVersion;
+            header.vendorID = properties.vendorID;
+            header.deviceID = properties.deviceID;
+            header.driverVersion = properties.driverVersion;
+            std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+            return header;
+        }
+
+        // FNV-1a
+        static uint64_t checksum(ConstSpan<char> data){
+            uint64_t hash = 14695981039346656037ull;
+            for (char byte : data) {
+                hash ^= static_cast<uint8_t>(byte);
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+    };
+#endif
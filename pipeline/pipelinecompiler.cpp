@@ -0,0 +1,65 @@
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include "graphicspipeline.cpp"
+#include "threadpool.cpp"
+
+#ifndef PIPELINE_COMPILER
+#define PIPELINE_COMPILER
+    struct CompiledPipeline {
+        std::string name;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        double compileMilliseconds = 0.0;
+    };
+
+    // Builds pipelines on a pool of worker threads. vkCreateGraphicsPipelines and the pipeline cache are safe to use
+    // from several threads at once, so callers can keep doing device setup or rendering while pipelines compile and
+    // pick up the result from the returned future once it is ready.
+    class PipelineCompiler {
+        VkDevice device = VK_NULL_HANDLE;
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+        ThreadPool threadPool;
+
+        std::mutex recordsMutex;
+        std::vector<CompiledPipeline> records;
+
+    public:
+        void init(VkDevice& logicalDevice, VkPipelineCache& cache, size_t threadCount){
+            std::cout << "Initializing pipeline compiler with " << threadCount << " thread(s)..." << std::endl;
+            device = logicalDevice;
+            pipelineCache = cache;
+            threadPool.init(threadCount);
+        }
+
+        std::shared_future<CompiledPipeline> submit(GraphicsPipelineDescription description){
+            return threadPool.submit([this, description] {
+                auto start = std::chrono::steady_clock::now();
+
+                CompiledPipeline compiled;
+                compiled.name = description.name;
+                compiled.pipeline = createGraphicsPipeline(device, description, pipelineCache);
+                compiled.compileMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                std::lock_guard<std::mutex> lock(recordsMutex);
+                records.push_back(compiled);
+                return compiled;
+            }).share();
+        }
+
+        static bool isReady(const std::shared_future<CompiledPipeline>& pending){
+            return pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }
+
+        // Name and compile time of every pipeline finished so far.
+        std::vector<CompiledPipeline> getCompileTimes(){
+            std::lock_guard<std::mutex> lock(recordsMutex);
+            return records;
+        }
+
+        // Waits for outstanding compilations. Pipelines themselves are owned and destroyed by the caller.
+        void cleanup(){
+            threadPool.cleanup();
+        }
+    };
+#endif
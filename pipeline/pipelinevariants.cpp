@@ -0,0 +1,86 @@
+#include <iostream>
+#include <unordered_map>
+#include "pipelinecompiler.cpp"
+
+#ifndef PIPELINE_VARIANTS
+#define PIPELINE_VARIANTS
+    // Pipelines keyed by their full description. Requesting a description that was seen before returns the same
+    // pipeline from a hash lookup; a new one is compiled once on the PipelineCompiler and kept. The cache owns every
+    // pipeline it hands out and destroys them in cleanup(), so callers can switch between variants freely without
+    // retiring anything. Variants that will not be requested again, e.g. ones built from shaders that were since
+    // reloaded, are taken out with evict(). Only used from the render thread.
+    class PipelineVariantCache {
+        struct DescriptionHash {
+            size_t operator()(const GraphicsPipelineDescription& description) const {
+                return description.hash();
+            }
+        };
+
+        PipelineCompiler* compiler = nullptr;
+        std::unordered_map<GraphicsPipelineDescription, std::shared_future<CompiledPipeline>, DescriptionHash> variants;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+
+    public:
+        void init(PipelineCompiler& pipelineCompiler){
+            std::cout << "Initializing pipeline variant cache..." << std::endl;
+            compiler = &pipelineCompiler;
+        }
+
+        // The variant for description, which may still be compiling. A variant that failed to build keeps
+        // rethrowing its error.
+        std::shared_future<CompiledPipeline> request(const GraphicsPipelineDescription& description){
+            auto variant = variants.find(description);
+            if (variant != variants.end()) {
+                hits++;
+                return variant->second;
+            }
+            misses++;
+            std::shared_future<CompiledPipeline> pending = compiler->submit(description);
+            variants.emplace(description, pending);
+            return pending;
+        }
+
+        // Like request(), but waits for the variant to be built.
+        VkPipeline get(const GraphicsPipelineDescription& description){
+            return request(description).get().pipeline;
+        }
+
+        // Removes the variant and hands its pipeline over to the caller, which has to retire it once no frame uses it.
+        // Returns VK_NULL_HANDLE if the variant is unknown or failed to build; must not be called while it compiles.
+        VkPipeline evict(const GraphicsPipelineDescription& description){
+            auto variant = variants.find(description);
+            if (variant == variants.end()) {
+                return VK_NULL_HANDLE;
+            }
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            try {
+                pipeline = variant->second.get().pipeline;
+            } catch (const std::exception&) {}
+            variants.erase(variant);
+            return pipeline;
+        }
+
+        uint64_t getHits(){
+            return hits;
+        }
+
+        uint64_t getMisses(){
+            return misses;
+        }
+
+        size_t getSize(){
+            return variants.size();
+        }
+
+        // The compiler must be cleaned up first, so nothing is still being built.
+        void cleanup(VkDevice& device){
+            for (auto& variant : variants) {
+                try {
+                    vkDestroyPipeline(device, variant.second.get().pipeline, nullptr);
+                } catch (const std::exception&) {}
+            }
+            variants.clear();
+        }
+    };
+#endif
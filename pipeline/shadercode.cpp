@@ -0,0 +1,51 @@
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include "fileutils.cpp"
+// Generated at build time from pipeline/shaders, see cmake/Shaders.cmake.
+#include "shader.vert.h"
+#include "shader.frag.h"
+#include "bindless.vert.h"
+#include "cull.comp.h"
+
+#ifndef SHADER_CODE
+#define SHADER_CODE
+    // SPIR-V words embedded in the executable, so shader modules are created without file I/O and independently of
+    // the working directory.
+    struct ShaderCode {
+        const uint32_t* words = nullptr;
+        size_t size = 0; // in bytes, as VkShaderModuleCreateInfo expects
+        // FNV-1a of the words. Identifies the code by content, so pipeline variants can be looked up without keeping
+        // the words themselves alive (mapped code goes away on the next shader reload).
+        uint64_t hash = 0;
+
+        static constexpr uint64_t hashWords(const uint32_t* words, size_t count) {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (size_t i = 0; i < count; i++) {
+                hash = (hash ^ words[i]) * 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        template<size_t WordCount>
+        static constexpr ShaderCode embedded(const uint32_t (&spirv)[WordCount]) {
+            return {spirv, WordCount * sizeof(uint32_t), hashWords(spirv, WordCount)};
+        }
+
+        // Code in a .spv file mapped at runtime, valid for as long as the file stays mapped.
+        static ShaderCode mapped(const MappedFile& file) {
+            ConstSpan<uint32_t> words = file.span<uint32_t>();
+            if (words.size == 0 || words[0] != 0x07230203u) {
+                throw std::runtime_error("mapped file is not SPIR-V!");
+            }
+            return {words.data, words.sizeBytes(), hashWords(words.data, words.size)};
+        }
+    };
+
+    namespace shaders {
+        constexpr ShaderCode triangleVert = ShaderCode::embedded(shader_vert);
+        constexpr ShaderCode triangleFrag = ShaderCode::embedded(shader_frag);
+        constexpr ShaderCode bindlessVert = ShaderCode::embedded(bindless_vert);
+        constexpr ShaderCode cullComp = ShaderCode::embedded(cull_comp);
+    }
+#endif
@@ -0,0 +1,143 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "assetloader.cpp"
+
+#ifndef SHADER_RELOADER
+#define SHADER_RELOADER
+    // Set by the build (see CMakeLists.txt) to the shader sources and the compiler used to embed them.
+    #ifndef SHADER_SOURCE_DIR
+    #define SHADER_SOURCE_DIR "pipeline/shaders"
+    #endif
+    #ifndef GLSLANG_VALIDATOR_PATH
+    #define GLSLANG_VALIDATOR_PATH "glslangValidator"
+    #endif
+
+    // Watches shader sources on a background thread and recompiles any that change to SPIR-V with glslangValidator.
+    // Successfully compiled shaders are mapped and queued until the render thread collects them with takeChanges();
+    // a source that fails to compile is reported and skipped, so the shader in use stays as it was.
+    //
+    // Sources are polled by modification time rather than through OS change notifications, which is portable and
+    // cheap for a handful of files.
+    class ShaderReloader {
+        struct WatchedShader {
+            std::string name;
+            std::filesystem::path source;
+            std::filesystem::file_time_type lastWrite;
+        };
+
+        const std::chrono::milliseconds pollInterval = std::chrono::milliseconds(250);
+
+        std::string compiler;
+        std::filesystem::path outputDirectory;
+        std::vector<WatchedShader> watched;
+        uint32_t generation = 0;
+
+        std::thread watcher;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+        std::map<std::string, MappedAsset> changes;
+
+    public:
+        // names are files in SHADER_SOURCE_DIR, e.g. "shader.frag".
+        void init(const std::vector<std::string>& names) {
+            std::cout << "Watching " << names.size() << " shader(s) in " << SHADER_SOURCE_DIR << " for changes..." << std::endl;
+            compiler = GLSLANG_VALIDATOR_PATH;
+            outputDirectory = std::filesystem::temp_directory_path() / "vulkan_base_shaders";
+            std::filesystem::create_directories(outputDirectory);
+
+            for (const std::string& name : names) {
+                WatchedShader shader;
+                shader.name = name;
+                shader.source = std::filesystem::path(SHADER_SOURCE_DIR) / name;
+                std::error_code error;
+                shader.lastWrite = std::filesystem::last_write_time(shader.source, error);
+                watched.push_back(shader);
+            }
+
+            stopping = false;
+            watcher = std::thread([this] { watch(); });
+        }
+
+        // Moves the newest compiled SPIR-V of every shader that changed since the last call into compiled, keyed by
+        // name. Returns false if nothing changed.
+        bool takeChanges(std::map<std::string, MappedAsset>& compiled) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (changes.empty()) {
+                return false;
+            }
+            compiled = std::move(changes);
+            changes.clear();
+            return true;
+        }
+
+        void cleanup() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            if (watcher.joinable()) {
+                watcher.join();
+            }
+            changes.clear();
+        }
+
+    private:
+        void watch() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!condition.wait_for(lock, pollInterval, [this] { return stopping; })) {
+                lock.unlock();
+                for (WatchedShader& shader : watched) {
+                    std::error_code error;
+                    std::filesystem::file_time_type lastWrite = std::filesystem::last_write_time(shader.source, error);
+                    if (error || lastWrite == shader.lastWrite) {
+                        continue;
+                    }
+                    shader.lastWrite = lastWrite;
+
+                    MappedAsset spirv = compile(shader);
+                    if (spirv) {
+                        std::lock_guard<std::mutex> changesLock(mutex);
+                        changes[shader.name] = spirv;
+                    }
+                }
+                lock.lock();
+            }
+        }
+
+        // Every compilation gets its own output file, so a file still mapped by a pipeline in use is never rewritten.
+        MappedAsset compile(const WatchedShader& shader) {
+            std::filesystem::path output = outputDirectory / (shader.name + "." + std::to_string(++generation) + ".spv");
+            std::string command = "\"" + compiler + "\" -V \"" + shader.source.string() + "\" -o \"" + output.string() + "\"";
+#ifdef _WIN32
+            // cmd.exe strips the outer quotes of a command line that starts with one.
+            command = "\"" + command + "\"";
+#endif
+            std::cout << "Recompiling " << shader.name << "..." << std::endl;
+            if (std::system(command.c_str()) != 0) {
+                std::cout << "Failed to compile " << shader.name << ", keeping the previous version." << std::endl;
+                return nullptr;
+            }
+
+            try {
+                MappedAsset spirv = AssetLoader::load(output.string());
+                // The mapping outlives the name on POSIX; where it does not, the file stays until the next restart.
+                std::error_code error;
+                std::filesystem::remove(output, error);
+                return spirv;
+            } catch (const std::exception& exception) {
+                std::cout << "Failed to load " << output.string() << ": " << exception.what() << std::endl;
+                return nullptr;
+            }
+        }
+    };
+#endif
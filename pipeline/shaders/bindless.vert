@@ -0,0 +1,38 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+struct Instance {
+    // xy offset, z scale, w rotation.
+    vec4 transform;
+    vec4 color;
+};
+
+// One block of the uniform ring per draw, selected by a dynamic offset.
+layout(set = 0, binding = 0) uniform DrawUniforms {
+    mat4 transform;
+} draw;
+
+// The bindless table's storage buffers; the instances are read through a handle instead of vertex attributes.
+layout(set = 1, binding = 1) readonly buffer InstanceBuffer {
+    Instance instances[];
+} buffers[];
+
+layout(push_constant) uniform DrawPushConstants {
+    uint instanceBuffer;
+} handles;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    // gl_InstanceIndex includes firstInstance, so it indexes the whole instance buffer.
+    Instance instance = buffers[handles.instanceBuffer].instances[gl_InstanceIndex];
+    float s = sin(instance.transform.w);
+    float c = cos(instance.transform.w);
+    vec2 position = mat2(c, s, -s, c) * inPosition * instance.transform.z + instance.transform.xy;
+    gl_Position = draw.transform * vec4(position, 0.0, 1.0);
+    fragColor = inColor * instance.color.rgb;
+}
\ No newline at end of file
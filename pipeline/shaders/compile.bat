@@ -1,3 +0,0 @@
-C:/VulkanSDK/1.1.108.0/Bin32/glslangValidator.exe -V shader.vert
-C:/VulkanSDK/1.1.108.0/Bin32/glslangValidator.exe -V shader.frag
-pause
\ No newline at end of file
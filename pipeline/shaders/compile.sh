@@ -1,2 +0,0 @@
-/home/user/VulkanSDK/x.x.x.x/x86_64/bin/glslangValidator -V shader.vert
-/home/user/VulkanSDK/x.x.x.x/x86_64/bin/glslangValidator -V shader.frag
\ No newline at end of file
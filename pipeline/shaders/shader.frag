@@ -1,10 +1,13 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Specialized per pipeline variant rather than read from a uniform.
+layout(constant_id = 0) const float ALPHA = 1.0;
+
 layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    outColor = vec4(fragColor, ALPHA);
 }
\ No newline at end of file
@@ -1,21 +1,23 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) out vec3 fragColor;
+// One block of the uniform ring per draw, selected by a dynamic offset.
+layout(set = 0, binding = 0) uniform DrawUniforms {
+    mat4 transform;
+} draw;
 
-vec2 positions[3] = vec2[](
-vec2(0.0, -0.5),
-vec2(0.5, 0.5),
-vec2(-0.5, 0.5)
-);
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+// Per instance: xy offset, z scale, w rotation.
+layout(location = 2) in vec4 instanceTransform;
+layout(location = 3) in vec4 instanceColor;
 
-vec3 colors[3] = vec3[](
-vec3(1.0, 0.0, 0.0),
-vec3(0.0, 1.0, 0.0),
-vec3(0.0, 0.0, 1.0)
-);
+layout(location = 0) out vec3 fragColor;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    float s = sin(instanceTransform.w);
+    float c = cos(instanceTransform.w);
+    vec2 position = mat2(c, s, -s, c) * inPosition * instanceTransform.z + instanceTransform.xy;
+    gl_Position = draw.transform * vec4(position, 0.0, 1.0);
+    fragColor = inColor * instanceColor.rgb;
 }
\ No newline at end of file
@@ -6,9 +6,13 @@
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        // Families without graphics support (and, for transfer, without compute) so work submitted there can run
+        // alongside graphics. Empty when the device has none.
+        std::optional<uint32_t> transferFamily;
+        std::optional<uint32_t> computeFamily;
 
-        bool isComplete() {
-            return graphicsFamily.has_value() && presentFamily.has_value();
+        bool isComplete(bool requirePresent = true) {
+            return graphicsFamily.has_value() && (presentFamily.has_value() || !requirePresent);
         }
     };
 #endif
\ No newline at end of file
@@ -1,62 +1,347 @@
 #include "QueueFamilyIndices.cpp"
 #include "syncobjects.cpp"
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// Used when neither the command line nor the present policy asks for a different depth.
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
 
+// value is only used for timeline semaphores.
+struct SemaphoreWait {
+    VkSemaphore semaphore;
+    VkPipelineStageFlags stage;
+    uint64_t value = 0;
+};
+
+struct SemaphoreSignal {
+    VkSemaphore semaphore;
+    uint64_t value = 0;
+};
+
+// Two synchronization backends are available. The binary backend uses a fence per frame slot for host waits and a
+// binary semaphore per frame slot and queue for cross-queue dependencies. The timeline backend (Vulkan 1.2) gives each
+// queue one timeline semaphore whose value counts its submissions: host waits and cross-queue waits are both waits for
+// a value, no fences are involved, and any thread can wait for or poll "graphics submission N complete". Binary
+// semaphores remain for acquire and present, which cannot use timeline semaphores.
+//
+// Graphics submissions are numbered from 1 in both backends, see getSubmittedValue().
 class QueueManager{
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueue;
+    VkQueue computeQueue;
+
+    uint32_t graphicsFamily;
+    uint32_t transferFamily;
+    uint32_t computeFamily;
 
     std::vector<VkSemaphore> renderFinishedSemaphores;
+    std::vector<VkSemaphore> transferCompleteSemaphores;
+    std::vector<VkSemaphore> computeCompleteSemaphores;
     std::vector<VkFence> inFlightFences;
 
+    bool timelineEnabled = false;
+    VkSemaphore graphicsTimeline = VK_NULL_HANDLE;
+    VkSemaphore transferTimeline = VK_NULL_HANDLE;
+    VkSemaphore computeTimeline = VK_NULL_HANDLE;
+    uint64_t graphicsValue = 0;
+    uint64_t transferValue = 0;
+    uint64_t computeValue = 0;
+
+    // The graphics submission value last submitted by each frame slot, and the transfer and compute values signaled
+    // for it.
+    std::vector<uint64_t> frameValues;
+    std::vector<uint64_t> transferFrameValues;
+    std::vector<uint64_t> computeFrameValues;
+    // The graphics submission value of the frame that last rendered to each swap chain image, or 0.
+    std::vector<uint64_t> imagesInFlight;
+
 public:
-    void init(VkDevice& device, QueueFamilyIndices queueFamilyIndices){
+    // Without dedicated families, transfer and compute work goes to the graphics queue. The timeline backend needs a
+    // Vulkan 1.2 device created with the timelineSemaphore feature.
+    void init(VkDevice& device, QueueFamilyIndices queueFamilyIndices, uint32_t framesInFlight, bool useTimelineSemaphores = false){
         std::cout << "Initializing queue manager..." << std::endl;
-        vkGetDeviceQueue(device, queueFamilyIndices.graphicsFamily.value(), 0, &graphicsQueue);
-        vkGetDeviceQueue(device, queueFamilyIndices.presentFamily.value(), 0, &presentQueue);
-        createSyncObjects(device);
+        graphicsFamily = queueFamilyIndices.graphicsFamily.value();
+        transferFamily = queueFamilyIndices.transferFamily.value_or(graphicsFamily);
+        computeFamily = queueFamilyIndices.computeFamily.value_or(graphicsFamily);
+
+        vkGetDeviceQueue(device, graphicsFamily, 0, &graphicsQueue);
+        vkGetDeviceQueue(device, transferFamily, 0, &transferQueue);
+        vkGetDeviceQueue(device, computeFamily, 0, &computeQueue);
+        if (queueFamilyIndices.presentFamily.has_value()) {
+            vkGetDeviceQueue(device, queueFamilyIndices.presentFamily.value(), 0, &presentQueue);
+        }
+        if (hasDedicatedTransferQueue()) {
+            std::cout << "Using dedicated transfer queue family " << transferFamily << "." << std::endl;
+        }
+        if (hasDedicatedComputeQueue()) {
+            std::cout << "Using dedicated compute queue family " << computeFamily << "." << std::endl;
+        }
+        timelineEnabled = useTimelineSemaphores;
+        std::cout << "Using " << (timelineEnabled ? "timeline" : "binary") << " semaphore synchronization." << std::endl;
+        createSyncObjects(device, framesInFlight);
     }
 
-    void submitToGraphicsQueue(VkSubmitInfo submitInfo, size_t currentFrame, std::vector<VkSemaphore>& imageAvailableSemaphores){
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.pWaitDstStageMask = waitStages;
+    void submitToGraphicsQueue(VkSubmitInfo submitInfo, size_t currentFrame, std::vector<VkSemaphore>& imageAvailableSemaphores,
+                               std::vector<SemaphoreWait> extraWaits = {}){
+        extraWaits.push_back({imageAvailableSemaphores[currentFrame], VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT});
+        submitGraphics(submitInfo, currentFrame, extraWaits, {{renderFinishedSemaphores[currentFrame]}});
+    }
 
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
+    // Headless submission: there is no acquired image to wait on and nothing to present.
+    void submitToGraphicsQueue(VkSubmitInfo submitInfo, size_t currentFrame, std::vector<SemaphoreWait> extraWaits = {}){
+        submitGraphics(submitInfo, currentFrame, extraWaits, {});
+    }
 
-        VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+    // The frame's graphics submission must wait on getTransferCompleteWait(currentFrame).
+    void submitToTransferQueue(std::vector<VkCommandBuffer>& commandBuffers, size_t currentFrame){
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        submitInfo.pCommandBuffers = commandBuffers.data();
+        if (timelineEnabled) {
+            transferFrameValues[currentFrame] = ++transferValue;
+            submit(transferQueue, submitInfo, {}, {{transferTimeline, transferValue}}, VK_NULL_HANDLE);
+        } else {
+            submit(transferQueue, submitInfo, {}, {{transferCompleteSemaphores[currentFrame]}}, VK_NULL_HANDLE);
+        }
+    }
 
-        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
+    // Work waiting on the result must wait on getComputeCompleteWait(currentFrame).
+    void submitToComputeQueue(std::vector<VkCommandBuffer>& commandBuffers, size_t currentFrame, std::vector<SemaphoreWait> waits = {}){
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        submitInfo.pCommandBuffers = commandBuffers.data();
+        if (timelineEnabled) {
+            computeFrameValues[currentFrame] = ++computeValue;
+            submit(computeQueue, submitInfo, waits, {{computeTimeline, computeValue}}, VK_NULL_HANDLE);
+        } else {
+            submit(computeQueue, submitInfo, waits, {{computeCompleteSemaphores[currentFrame]}}, VK_NULL_HANDLE);
         }
     }
 
-    void submitToPresentQueue(VkPresentInfoKHR presentInfo, size_t currentFrame){
+    // Returns VK_ERROR_OUT_OF_DATE_KHR or VK_SUBOPTIMAL_KHR when the swap chain should be recreated.
+    VkResult submitToPresentQueue(VkPresentInfoKHR presentInfo, size_t currentFrame){
         VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
         presentInfo.waitSemaphoreCount = 1;
         presentInfo.pWaitSemaphores = signalSemaphores;
-        vkQueuePresentKHR(presentQueue, &presentInfo);
+        VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR) {
+            throw std::runtime_error("failed to present swap chain image!");
+        }
+        return result;
     }
 
+    // Waits until the frame slot's last graphics submission has completed.
     void waitForFences(VkDevice& device, size_t currentFrame){
-        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-        vkResetFences(device, 1, &inFlightFences[currentFrame]);
+        waitForSubmission(device, frameValues[currentFrame]);
+    }
+
+    // Blocks until graphics submission value has completed. Safe to call from any thread with the timeline backend;
+    // the binary backend must not race a resetFence() of the slot holding value.
+    void waitForSubmission(VkDevice& device, uint64_t value){
+        if (value == 0) {
+            return;
+        }
+        if (timelineEnabled) {
+            VkSemaphoreWaitInfo waitInfo = {};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &graphicsTimeline;
+            waitInfo.pValues = &value;
+            vkWaitSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max());
+            return;
+        }
+        // A slot is only resubmitted after its fence was waited on, so a value no slot holds any more is complete.
+        for (size_t i = 0; i < frameValues.size(); i++) {
+            if (frameValues[i] == value) {
+                vkWaitForFences(device, 1, &inFlightFences[i], VK_TRUE, std::numeric_limits<uint64_t>::max());
+            }
+        }
+    }
+
+    // The highest graphics submission value known to have completed, without blocking.
+    uint64_t getCompletedValue(VkDevice& device){
+        uint64_t completed = 0;
+        if (timelineEnabled) {
+            vkGetSemaphoreCounterValue(device, graphicsTimeline, &completed);
+            return completed;
+        }
+        // Graphics submissions complete in order, so the newest signaled slot bounds everything before it.
+        for (size_t i = 0; i < frameValues.size(); i++) {
+            if (frameValues[i] > completed && vkGetFenceStatus(device, inFlightFences[i]) == VK_SUCCESS) {
+                completed = frameValues[i];
+            }
+        }
+        return completed;
+    }
+
+    // The value of the most recent graphics submission.
+    uint64_t getSubmittedValue(){
+        return graphicsValue;
+    }
+
+    // Forgets which frames used the swap chain images, e.g. after the swap chain has been recreated.
+    void resetImagesInFlight(size_t imageCount){
+        imagesInFlight.assign(imageCount, 0);
+    }
+
+    // With more frames in flight than swap chain images, or images acquired out of order, an acquired image can still
+    // be in use by another frame slot's submission. Waits for that submission, then records the frame about to be
+    // submitted from currentFrame as the image's user. Returns false if there was nothing to wait for.
+    bool waitForImage(VkDevice& device, uint32_t imageIndex, size_t currentFrame){
+        bool waited = false;
+        uint64_t value = imagesInFlight[imageIndex];
+        // Everything up to the slot's own previous submission has already been waited on.
+        if (value > frameValues[currentFrame]) {
+            waitForSubmission(device, value);
+            waited = true;
+        }
+        imagesInFlight[imageIndex] = graphicsValue + 1;
+        return waited;
+    }
+
+    // Must be called right before the frame's graphics submission rather than after the wait, so a frame that bails
+    // out before submitting (e.g. on an out of date swap chain) can wait on the fence again. No-op for timelines.
+    void resetFence(VkDevice& device, size_t currentFrame){
+        if (!timelineEnabled) {
+            vkResetFences(device, 1, &inFlightFences[currentFrame]);
+        }
+    }
+
+    bool isTimelineEnabled(){
+        return timelineEnabled;
+    }
+
+    VkQueue& getGraphicsQueue(){
+        return graphicsQueue;
+    }
+
+    VkQueue& getTransferQueue(){
+        return transferQueue;
+    }
+
+    VkQueue& getComputeQueue(){
+        return computeQueue;
+    }
+
+    uint32_t getGraphicsFamily(){
+        return graphicsFamily;
+    }
+
+    uint32_t getTransferFamily(){
+        return transferFamily;
+    }
+
+    uint32_t getComputeFamily(){
+        return computeFamily;
+    }
+
+    bool hasDedicatedTransferQueue(){
+        return transferFamily != graphicsFamily;
+    }
+
+    bool hasDedicatedComputeQueue(){
+        return computeFamily != graphicsFamily;
+    }
+
+    // The wait a graphics submission needs for the frame's transfer submission.
+    SemaphoreWait getTransferCompleteWait(size_t currentFrame){
+        if (timelineEnabled) {
+            return {transferTimeline, VK_PIPELINE_STAGE_TRANSFER_BIT, transferFrameValues[currentFrame]};
+        }
+        return {transferCompleteSemaphores[currentFrame], VK_PIPELINE_STAGE_TRANSFER_BIT};
+    }
+
+    SemaphoreWait getComputeCompleteWait(size_t currentFrame, VkPipelineStageFlags stage){
+        if (timelineEnabled) {
+            return {computeTimeline, stage, computeFrameValues[currentFrame]};
+        }
+        return {computeCompleteSemaphores[currentFrame], stage};
     }
 
     void cleanup(VkDevice& device){
         destroySemaphores(device, renderFinishedSemaphores);
-        destroyFences(device, inFlightFences);
+        if (timelineEnabled) {
+            vkDestroySemaphore(device, graphicsTimeline, nullptr);
+            vkDestroySemaphore(device, transferTimeline, nullptr);
+            vkDestroySemaphore(device, computeTimeline, nullptr);
+        } else {
+            destroySemaphores(device, transferCompleteSemaphores);
+            destroySemaphores(device, computeCompleteSemaphores);
+            destroyFences(device, inFlightFences);
+        }
     }
 
 private:
-    void createSyncObjects(VkDevice& device){
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    void createSyncObjects(VkDevice& device, uint32_t framesInFlight){
+        frameValues.assign(framesInFlight, 0);
+        transferFrameValues.assign(framesInFlight, 0);
+        computeFrameValues.assign(framesInFlight, 0);
+
+        renderFinishedSemaphores.resize(framesInFlight);
         createSemaphores(device, renderFinishedSemaphores);
+        if (timelineEnabled) {
+            createTimelineSemaphore(device, graphicsTimeline);
+            createTimelineSemaphore(device, transferTimeline);
+            createTimelineSemaphore(device, computeTimeline);
+            return;
+        }
+
+        transferCompleteSemaphores.resize(framesInFlight);
+        computeCompleteSemaphores.resize(framesInFlight);
+        inFlightFences.resize(framesInFlight);
+        createSemaphores(device, transferCompleteSemaphores);
+        createSemaphores(device, computeCompleteSemaphores);
         createFences(device, inFlightFences);
     }
+
+    void submitGraphics(VkSubmitInfo submitInfo, size_t currentFrame, const std::vector<SemaphoreWait>& waits,
+                        std::vector<SemaphoreSignal> signals){
+        frameValues[currentFrame] = ++graphicsValue;
+        if (timelineEnabled) {
+            signals.push_back({graphicsTimeline, graphicsValue});
+            submit(graphicsQueue, submitInfo, waits, signals, VK_NULL_HANDLE);
+        } else {
+            submit(graphicsQueue, submitInfo, waits, signals, inFlightFences[currentFrame]);
+        }
+    }
+
+    void submit(VkQueue& queue, VkSubmitInfo submitInfo, const std::vector<SemaphoreWait>& waits,
+                const std::vector<SemaphoreSignal>& signals, VkFence fence){
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        std::vector<uint64_t> waitValues;
+        for (auto& wait : waits) {
+            waitSemaphores.push_back(wait.semaphore);
+            waitStages.push_back(wait.stage);
+            waitValues.push_back(wait.value);
+        }
+        std::vector<VkSemaphore> signalSemaphores;
+        std::vector<uint64_t> signalValues;
+        for (auto& signal : signals) {
+            signalSemaphores.push_back(signal.semaphore);
+            signalValues.push_back(signal.value);
+        }
+
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        // Values of binary semaphores in the arrays are ignored.
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+        if (timelineEnabled) {
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+            timelineInfo.pWaitSemaphoreValues = waitValues.data();
+            timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+            timelineInfo.pSignalSemaphoreValues = signalValues.data();
+            submitInfo.pNext = &timelineInfo;
+        }
+
+        if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit command buffers!");
+        }
+    }
 };
\ No newline at end of file
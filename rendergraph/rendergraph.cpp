@@ -0,0 +1,723 @@
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "deviceallocator.cpp"
+#include "renderpass.cpp"
+#include "framebuffer.cpp"
+
+#ifndef RENDER_GRAPH
+#define RENDER_GRAPH
+    using RenderGraphImage = uint32_t;
+    using RenderGraphPass = uint32_t;
+
+    // How a pass uses an image; decides the layout the image is in during the pass and what it has to wait for.
+    enum class ImageUsage {
+        ColorWrite,
+        Sampled,
+        TransferRead,
+        TransferWrite
+    };
+
+    struct PassContext {
+        VkCommandBuffer commandBuffer;
+        uint32_t imageIndex;
+        VkExtent2D extent;
+    };
+
+    struct RenderGraphStatistics {
+        uint32_t declaredPasses = 0;
+        uint32_t culledPasses = 0;
+        uint32_t barriersPerFrame = 0;
+        uint32_t transientImages = 0;
+        // Memory the transient images would take on their own, and what they take with aliasing.
+        VkDeviceSize transientBytes = 0;
+        VkDeviceSize allocatedBytes = 0;
+    };
+
+    // Frame work described as passes that declare which images they read and write. compile() drops the passes whose
+    // results nothing uses, orders the rest so every image is written before it is read, and creates a render pass for
+    // each graphics pass. build() then creates the transient images for a target extent, letting images whose
+    // lifetimes do not overlap share memory, and plans the layout transitions and barriers between passes, so
+    // execute() records the frame without any hand-written synchronization.
+    //
+    // Every read of an image sees all of its writes; writes to the same image happen in declaration order. There is
+    // one imported image, the target (swap chain or offscreen image), which counts as the graph's output. Transients are
+    // shared by all frames in flight: the first barrier of a frame waits for the last use in the previous frame, which
+    // is earlier on the same queue.
+    class RenderGraph {
+        struct ImageState {
+            VkImageLayout layout;
+            VkPipelineStageFlags stages;
+            VkAccessFlags access;
+        };
+
+        struct Image {
+            std::string name;
+            VkFormat format;
+            bool imported = false;
+            VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            // Transients only: size relative to the target and the usage collected from the passes.
+            float scale = 1.0f;
+            VkImageUsageFlags usage = 0;
+        };
+
+        struct Access {
+            RenderGraphImage image;
+            ImageUsage usage;
+            bool clear = false;
+            VkClearColorValue clearColor = {};
+        };
+
+        struct Pass {
+            std::string name;
+            bool graphics = false;
+            bool sideEffects = false;
+            VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE;
+            std::function<void(const PassContext&)> record;
+            std::vector<Access> accesses;
+            RenderPass renderPass;
+        };
+
+        struct Barrier {
+            RenderGraphImage image;
+            VkImageLayout oldLayout;
+            VkImageLayout newLayout;
+            VkPipelineStageFlags srcStages;
+            VkAccessFlags srcAccess;
+            VkPipelineStageFlags dstStages;
+            VkAccessFlags dstAccess;
+        };
+
+    public:
+        // Everything build() creates for one target; handed out by releaseResources() so it can be retired while
+        // frames in flight still use it.
+        struct Resources {
+            std::vector<VkImage> images;
+            std::vector<VkImageView> views;
+            std::vector<Allocation> memory;
+            std::vector<FrameBuffer> frameBuffers;
+        };
+
+    private:
+        std::vector<Image> images;
+        std::vector<Pass> passes;
+        RenderGraphImage target = 0;
+        bool hasTarget = false;
+
+        // Set by compile().
+        std::vector<RenderGraphPass> order;
+
+        // Set by build().
+        VkExtent2D targetExtent = {};
+        std::vector<VkImage> targetImages;
+        Resources resources;
+        std::vector<std::vector<Barrier>> passBarriers;
+        std::vector<Barrier> finalBarriers;
+        RenderGraphStatistics statistics;
+
+    public:
+        // The image the frame ends up in, one per swap chain or offscreen image. finalLayout is the layout it is
+        // left in, e.g. PRESENT_SRC_KHR.
+        RenderGraphImage importTarget(const std::string& name, VkFormat format, VkImageLayout finalLayout) {
+            if (hasTarget) {
+                throw std::runtime_error("render graph already has a target!");
+            }
+            Image image;
+            image.name = name;
+            image.format = format;
+            image.imported = true;
+            image.finalLayout = finalLayout;
+            images.push_back(image);
+            target = static_cast<RenderGraphImage>(images.size() - 1);
+            hasTarget = true;
+            return target;
+        }
+
+        // An image that only lives within a frame, scale times the size of the target.
+        RenderGraphImage createTransient(const std::string& name, VkFormat format, float scale = 1.0f) {
+            Image image;
+            image.name = name;
+            image.format = format;
+            image.scale = scale;
+            images.push_back(image);
+            return static_cast<RenderGraphImage>(images.size() - 1);
+        }
+
+        // Graphics passes run inside a render pass over their color outputs; others (transfers, compute) record
+        // directly into the frame's command buffer.
+        RenderGraphPass addPass(const std::string& name, bool graphics, std::function<void(const PassContext&)> record,
+                                VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE) {
+            Pass pass;
+            pass.name = name;
+            pass.graphics = graphics;
+            pass.contents = contents;
+            pass.record = std::move(record);
+            passes.push_back(std::move(pass));
+            return static_cast<RenderGraphPass>(passes.size() - 1);
+        }
+
+        // A color attachment of a graphics pass, in the order of the fragment shader outputs.
+        void writeColor(RenderGraphPass pass, RenderGraphImage image, bool clear = false, VkClearColorValue clearColor = {}) {
+            Access access;
+            access.image = image;
+            access.usage = ImageUsage::ColorWrite;
+            access.clear = clear;
+            access.clearColor = clearColor;
+            addAccess(pass, access);
+        }
+
+        void use(RenderGraphPass pass, RenderGraphImage image, ImageUsage usage) {
+            if (usage == ImageUsage::ColorWrite) {
+                writeColor(pass, image);
+                return;
+            }
+            Access access;
+            access.image = image;
+            access.usage = usage;
+            addAccess(pass, access);
+        }
+
+        // Keeps the pass even if nothing reads what it writes.
+        void setSideEffects(RenderGraphPass pass) {
+            passes[pass].sideEffects = true;
+        }
+
+        // Culls and orders the passes and creates the render passes. Independent of the target size, so it only runs
+        // once; the render passes can be used to build pipelines right away.
+        void compile(VkDevice& device) {
+            std::cout << "Compiling render graph..." << std::endl;
+            if (!hasTarget) {
+                throw std::runtime_error("render graph has no target!");
+            }
+            std::vector<std::vector<RenderGraphPass>> writers(images.size());
+            for (RenderGraphPass pass = 0; pass < passes.size(); pass++) {
+                for (auto& access : passes[pass].accesses) {
+                    if (isWrite(access.usage)) {
+                        writers[access.image].push_back(pass);
+                    }
+                }
+            }
+
+            // Passes that contribute to the target or have side effects, and everything they depend on.
+            std::vector<bool> alive(passes.size(), false);
+            std::vector<RenderGraphPass> pending;
+            for (RenderGraphPass pass = 0; pass < passes.size(); pass++) {
+                if (passes[pass].sideEffects || writes(pass, target)) {
+                    alive[pass] = true;
+                    pending.push_back(pass);
+                }
+            }
+            while (!pending.empty()) {
+                RenderGraphPass pass = pending.back();
+                pending.pop_back();
+                for (auto& dependency : getDependencies(pass, writers)) {
+                    if (!alive[dependency]) {
+                        alive[dependency] = true;
+                        pending.push_back(dependency);
+                    }
+                }
+            }
+
+            // Kahn's algorithm, taking the earliest declared of the ready passes so the order stays predictable.
+            std::vector<uint32_t> unmetDependencies(passes.size(), 0);
+            std::vector<std::vector<RenderGraphPass>> dependents(passes.size());
+            for (RenderGraphPass pass = 0; pass < passes.size(); pass++) {
+                if (!alive[pass]) {
+                    continue;
+                }
+                for (auto& dependency : getDependencies(pass, writers)) {
+                    unmetDependencies[pass]++;
+                    dependents[dependency].push_back(pass);
+                }
+            }
+            order.clear();
+            std::vector<bool> scheduled(passes.size(), false);
+            uint32_t aliveCount = static_cast<uint32_t>(std::count(alive.begin(), alive.end(), true));
+            while (order.size() < aliveCount) {
+                RenderGraphPass next = static_cast<RenderGraphPass>(passes.size());
+                for (RenderGraphPass pass = 0; pass < passes.size(); pass++) {
+                    if (alive[pass] && !scheduled[pass] && unmetDependencies[pass] == 0) {
+                        next = pass;
+                        break;
+                    }
+                }
+                if (next == passes.size()) {
+                    throw std::runtime_error("render graph has a cycle!");
+                }
+                scheduled[next] = true;
+                order.push_back(next);
+                for (auto& dependent : dependents[next]) {
+                    unmetDependencies[dependent]--;
+                }
+            }
+
+            statistics.declaredPasses = static_cast<uint32_t>(passes.size());
+            statistics.culledPasses = static_cast<uint32_t>(passes.size()) - aliveCount;
+            for (RenderGraphPass pass = 0; pass < passes.size(); pass++) {
+                if (!alive[pass]) {
+                    std::cout << "Culled render graph pass " << passes[pass].name << "." << std::endl;
+                }
+            }
+
+            for (size_t position = 0; position < order.size(); position++) {
+                Pass& pass = passes[order[position]];
+                if (!pass.graphics) {
+                    continue;
+                }
+                std::vector<VkAttachmentDescription> attachments;
+                for (auto& access : pass.accesses) {
+                    if (access.usage != ImageUsage::ColorWrite) {
+                        continue;
+                    }
+                    // Earlier contents only matter if an earlier pass wrote them, later ones only if someone reads them.
+                    VkAttachmentLoadOp loadOp = access.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                                                : isUsedBetween(access.image, 0, position) ? VK_ATTACHMENT_LOAD_OP_LOAD
+                                                : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                    VkAttachmentStoreOp storeOp = images[access.image].imported || isUsedBetween(access.image, position + 1, order.size())
+                                                  ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                    attachments.push_back(RenderPass::colorAttachment(images[access.image].format, loadOp, storeOp));
+                }
+                pass.renderPass.init(device, attachments);
+            }
+        }
+
+        // Creates the transients and framebuffers for a target of extent with the given images and views, and plans
+        // the barriers. Call releaseResources() first when rebuilding.
+        void build(VkDevice& device, DeviceAllocator& allocator, VkExtent2D extent, const std::vector<VkImage>& targetImageList,
+                   const std::vector<VkImageView>& targetViews) {
+            targetExtent = extent;
+            targetImages = targetImageList;
+            resources.images.assign(images.size(), VK_NULL_HANDLE);
+            resources.views.assign(images.size(), VK_NULL_HANDLE);
+
+            std::vector<RenderGraphImage> previousOccupant = createTransients(device, allocator);
+            planBarriers(previousOccupant);
+
+            resources.frameBuffers.resize(passes.size());
+            for (auto pass : order) {
+                if (!passes[pass].graphics) {
+                    continue;
+                }
+                // One framebuffer per target image if the pass draws to the target, otherwise just one.
+                size_t framebufferCount = writes(pass, target) ? targetViews.size() : 1;
+                std::vector<std::vector<VkImageView>> attachments(framebufferCount);
+                for (size_t i = 0; i < framebufferCount; i++) {
+                    for (auto& access : passes[pass].accesses) {
+                        if (access.usage == ImageUsage::ColorWrite) {
+                            attachments[i].push_back(access.image == target ? targetViews[i] : resources.views[access.image]);
+                        }
+                    }
+                }
+                resources.frameBuffers[pass].init(device, attachments, getPassExtent(pass), passes[pass].renderPass.getRenderPass());
+            }
+        }
+
+        // Records every pass for the target image imageIndex.
+        void execute(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+            for (size_t position = 0; position < order.size(); position++) {
+                RenderGraphPass passIndex = order[position];
+                Pass& pass = passes[passIndex];
+                recordBarriers(commandBuffer, passBarriers[position], imageIndex);
+
+                PassContext context;
+                context.commandBuffer = commandBuffer;
+                context.imageIndex = imageIndex;
+                context.extent = getPassExtent(passIndex);
+                if (!pass.graphics) {
+                    pass.record(context);
+                    continue;
+                }
+
+                std::vector<VkClearValue> clearValues;
+                for (auto& access : pass.accesses) {
+                    if (access.usage == ImageUsage::ColorWrite) {
+                        VkClearValue clearValue = {};
+                        clearValue.color = access.clearColor;
+                        clearValues.push_back(clearValue);
+                    }
+                }
+
+                VkRenderPassBeginInfo renderPassInfo = {};
+                renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+                renderPassInfo.renderPass = pass.renderPass.getRenderPass();
+                renderPassInfo.framebuffer = getFramebuffer(passIndex, imageIndex);
+                renderPassInfo.renderArea.offset = {0, 0};
+                renderPassInfo.renderArea.extent = context.extent;
+                renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+                renderPassInfo.pClearValues = clearValues.data();
+
+                vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, pass.contents);
+                pass.record(context);
+                vkCmdEndRenderPass(commandBuffer);
+            }
+            recordBarriers(commandBuffer, finalBarriers, imageIndex);
+        }
+
+        VkRenderPass getRenderPass(RenderGraphPass pass) {
+            return passes[pass].renderPass.getRenderPass();
+        }
+
+        VkFramebuffer getFramebuffer(RenderGraphPass pass, uint32_t imageIndex) {
+            return resources.frameBuffers[pass].getBuffer(writes(pass, target) ? imageIndex : 0);
+        }
+
+        // The extent of the pass's first color output, or of its first image for other passes.
+        VkExtent2D getPassExtent(RenderGraphPass pass) {
+            for (auto& access : passes[pass].accesses) {
+                if (isWrite(access.usage)) {
+                    return getExtent(access.image);
+                }
+            }
+            return passes[pass].accesses.empty() ? targetExtent : getExtent(passes[pass].accesses[0].image);
+        }
+
+        VkExtent2D getExtent(RenderGraphImage image) {
+            if (images[image].imported) {
+                return targetExtent;
+            }
+            return {std::max(1u, static_cast<uint32_t>(targetExtent.width * images[image].scale)),
+                    std::max(1u, static_cast<uint32_t>(targetExtent.height * images[image].scale))};
+        }
+
+        VkImage getImage(RenderGraphImage image, uint32_t imageIndex) {
+            return image == target ? targetImages[imageIndex] : resources.images[image];
+        }
+
+        RenderGraphStatistics getStatistics() {
+            return statistics;
+        }
+
+        Resources releaseResources() {
+            Resources released = std::move(resources);
+            resources = Resources();
+            return released;
+        }
+
+        static void destroyResources(VkDevice& device, DeviceAllocator& allocator, Resources& released) {
+            for (auto& frameBuffer : released.frameBuffers) {
+                frameBuffer.cleanup(device);
+            }
+            for (size_t i = 0; i < released.views.size(); i++) {
+                if (released.views[i] != VK_NULL_HANDLE) {
+                    vkDestroyImageView(device, released.views[i], nullptr);
+                    vkDestroyImage(device, released.images[i], nullptr);
+                }
+            }
+            for (auto& memory : released.memory) {
+                allocator.free(memory);
+            }
+            released = Resources();
+        }
+
+        void cleanup(VkDevice& device, DeviceAllocator& allocator) {
+            destroyResources(device, allocator, resources);
+            for (auto& pass : passes) {
+                if (pass.renderPass.getRenderPass() != VK_NULL_HANDLE) {
+                    pass.renderPass.cleanup(device);
+                }
+            }
+        }
+
+    private:
+        static bool isWrite(ImageUsage usage) {
+            return usage == ImageUsage::ColorWrite || usage == ImageUsage::TransferWrite;
+        }
+
+        static ImageState getState(ImageUsage usage) {
+            switch (usage) {
+                case ImageUsage::ColorWrite:
+                    return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+                case ImageUsage::Sampled:
+                    return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                            VK_ACCESS_SHADER_READ_BIT};
+                case ImageUsage::TransferRead:
+                    return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+                case ImageUsage::TransferWrite:
+                    return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+            }
+            throw std::runtime_error("unknown image usage!");
+        }
+
+        static VkImageUsageFlags getImageUsage(ImageUsage usage) {
+            switch (usage) {
+                case ImageUsage::ColorWrite:
+                    return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+                case ImageUsage::Sampled:
+                    return VK_IMAGE_USAGE_SAMPLED_BIT;
+                case ImageUsage::TransferRead:
+                    return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                case ImageUsage::TransferWrite:
+                    return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            }
+            return 0;
+        }
+
+        void addAccess(RenderGraphPass pass, const Access& access) {
+            for (auto& existing : passes[pass].accesses) {
+                if (existing.image == access.image) {
+                    throw std::runtime_error("render graph pass " + passes[pass].name + " uses image " + images[access.image].name + " twice!");
+                }
+            }
+            passes[pass].accesses.push_back(access);
+            images[access.image].usage |= getImageUsage(access.usage);
+        }
+
+        bool writes(RenderGraphPass pass, RenderGraphImage image) {
+            for (auto& access : passes[pass].accesses) {
+                if (access.image == image && isWrite(access.usage)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Readers depend on every writer of what they read, and writers on the earlier declared writers of what they
+        // write, unless they clear it.
+        std::vector<RenderGraphPass> getDependencies(RenderGraphPass pass, const std::vector<std::vector<RenderGraphPass>>& writers) {
+            std::vector<RenderGraphPass> dependencies;
+            for (auto& access : passes[pass].accesses) {
+                for (auto writer : writers[access.image]) {
+                    bool needed = isWrite(access.usage) ? writer < pass && !access.clear : writer != pass;
+                    if (needed && std::find(dependencies.begin(), dependencies.end(), writer) == dependencies.end()) {
+                        dependencies.push_back(writer);
+                    }
+                }
+            }
+            return dependencies;
+        }
+
+        // Whether a pass at an order position in [begin, end) uses image.
+        bool isUsedBetween(RenderGraphImage image, size_t begin, size_t end) {
+            for (size_t position = begin; position < end; position++) {
+                for (auto& access : passes[order[position]].accesses) {
+                    if (access.image == image) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        // Creates the transients used by the ordered passes. Images are placed greedily in memory slots, in order of
+        // first use: an image reuses a slot whose previous occupant was last used before the image is first used.
+        // Returns, for each transient, the image that used its memory before it, which it has to wait for (for the
+        // first occupant of a slot, the slot's last one, from the previous frame).
+        std::vector<RenderGraphImage> createTransients(VkDevice& device, DeviceAllocator& allocator) {
+            struct Lifetime {
+                RenderGraphImage image;
+                size_t first;
+                size_t last;
+                VkMemoryRequirements requirements;
+            };
+            struct Slot {
+                VkMemoryRequirements requirements;
+                size_t last;
+                std::vector<RenderGraphImage> occupants;
+            };
+
+            std::vector<Lifetime> lifetimes;
+            for (RenderGraphImage image = 0; image < images.size(); image++) {
+                if (images[image].imported) {
+                    continue;
+                }
+                Lifetime lifetime = {image, order.size(), 0, {}};
+                for (size_t position = 0; position < order.size(); position++) {
+                    for (auto& access : passes[order[position]].accesses) {
+                        if (access.image == image) {
+                            lifetime.first = std::min(lifetime.first, position);
+                            lifetime.last = position;
+                        }
+                    }
+                }
+                if (lifetime.first == order.size()) {
+                    continue;
+                }
+                resources.images[image] = createImage(device, images[image], getExtent(image));
+                vkGetImageMemoryRequirements(device, resources.images[image], &lifetime.requirements);
+                lifetimes.push_back(lifetime);
+            }
+            std::sort(lifetimes.begin(), lifetimes.end(), [](const Lifetime& a, const Lifetime& b) { return a.first < b.first; });
+
+            std::vector<Slot> slots;
+            std::vector<size_t> slotOf(images.size(), 0);
+            statistics.transientImages = static_cast<uint32_t>(lifetimes.size());
+            statistics.transientBytes = 0;
+            for (auto& lifetime : lifetimes) {
+                statistics.transientBytes += lifetime.requirements.size;
+                size_t chosen = slots.size();
+                for (size_t slot = 0; slot < slots.size(); slot++) {
+                    if (slots[slot].last < lifetime.first && (slots[slot].requirements.memoryTypeBits & lifetime.requirements.memoryTypeBits) != 0) {
+                        chosen = slot;
+                        break;
+                    }
+                }
+                if (chosen == slots.size()) {
+                    slots.push_back({lifetime.requirements, lifetime.last, {}});
+                } else {
+                    VkMemoryRequirements& requirements = slots[chosen].requirements;
+                    requirements.size = std::max(requirements.size, lifetime.requirements.size);
+                    requirements.alignment = std::max(requirements.alignment, lifetime.requirements.alignment);
+                    requirements.memoryTypeBits &= lifetime.requirements.memoryTypeBits;
+                    slots[chosen].last = lifetime.last;
+                }
+                slots[chosen].occupants.push_back(lifetime.image);
+                slotOf[lifetime.image] = chosen;
+            }
+
+            std::vector<RenderGraphImage> previousOccupant(images.size(), 0);
+            statistics.allocatedBytes = 0;
+            for (auto& slot : slots) {
+                Allocation memory = allocator.allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Optimal);
+                statistics.allocatedBytes += slot.requirements.size;
+                for (size_t i = 0; i < slot.occupants.size(); i++) {
+                    RenderGraphImage image = slot.occupants[i];
+                    vkBindImageMemory(device, resources.images[image], memory.memory, memory.offset);
+                    resources.views[image] = createView(device, resources.images[image], images[image].format);
+                    previousOccupant[image] = slot.occupants[(i + slot.occupants.size() - 1) % slot.occupants.size()];
+                }
+                resources.memory.push_back(memory);
+            }
+            return previousOccupant;
+        }
+
+        // Walks the ordered passes and records a barrier wherever an image changes layout or a write is involved.
+        // Reads in the same layout just widen the set of stages the next barrier waits for.
+        void planBarriers(const std::vector<RenderGraphImage>& previousOccupant) {
+            std::vector<ImageState> lastUse(images.size(), ImageState{VK_IMAGE_LAYOUT_UNDEFINED, 0, 0});
+            for (auto pass : order) {
+                for (auto& access : passes[pass].accesses) {
+                    lastUse[access.image] = getState(access.usage);
+                }
+            }
+
+            std::vector<ImageState> states(images.size());
+            for (RenderGraphImage image = 0; image < images.size(); image++) {
+                if (images[image].imported) {
+                    // The target arrives through the acquire semaphore, which is waited for at color output.
+                    states[image] = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+                } else {
+                    // Contents never carry over, but the memory may still be in use by the previous occupant.
+                    const ImageState& previous = lastUse[previousOccupant[image]];
+                    states[image] = {VK_IMAGE_LAYOUT_UNDEFINED, previous.stages, previous.access};
+                }
+            }
+
+            passBarriers.assign(order.size(), {});
+            statistics.barriersPerFrame = 0;
+            for (size_t position = 0; position < order.size(); position++) {
+                for (auto& access : passes[order[position]].accesses) {
+                    ImageState needed = getState(access.usage);
+                    ImageState& current = states[access.image];
+                    if (current.layout == needed.layout && !hasWrite(current.access) && !isWrite(access.usage)) {
+                        current.stages |= needed.stages;
+                        current.access |= needed.access;
+                        continue;
+                    }
+                    passBarriers[position].push_back(makeBarrier(access.image, current, needed));
+                    current = needed;
+                }
+                statistics.barriersPerFrame += static_cast<uint32_t>(passBarriers[position].size());
+            }
+
+            ImageState presented = {images[target].finalLayout, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0};
+            finalBarriers = {makeBarrier(target, states[target], presented)};
+            statistics.barriersPerFrame++;
+        }
+
+        static bool hasWrite(VkAccessFlags access) {
+            return (access & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT)) != 0;
+        }
+
+        static Barrier makeBarrier(RenderGraphImage image, const ImageState& from, const ImageState& to) {
+            Barrier barrier;
+            barrier.image = image;
+            barrier.oldLayout = from.layout;
+            barrier.newLayout = to.layout;
+            barrier.srcStages = from.stages;
+            if (barrier.srcStages == 0) {
+                barrier.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            }
+            // Only writes need to be made available; for reads the execution dependency is enough.
+            barrier.srcAccess = from.access & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+            barrier.dstStages = to.stages;
+            barrier.dstAccess = to.access;
+            return barrier;
+        }
+
+        // All barriers of a pass go into one vkCmdPipelineBarrier.
+        void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers, uint32_t imageIndex) {
+            if (barriers.empty()) {
+                return;
+            }
+            std::vector<VkImageMemoryBarrier> imageBarriers;
+            VkPipelineStageFlags srcStages = 0;
+            VkPipelineStageFlags dstStages = 0;
+            for (auto& barrier : barriers) {
+                VkImageMemoryBarrier imageBarrier = {};
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageBarrier.srcAccessMask = barrier.srcAccess;
+                imageBarrier.dstAccessMask = barrier.dstAccess;
+                imageBarrier.oldLayout = barrier.oldLayout;
+                imageBarrier.newLayout = barrier.newLayout;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = getImage(barrier.image, imageIndex);
+                imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                imageBarrier.subresourceRange.levelCount = 1;
+                imageBarrier.subresourceRange.layerCount = 1;
+                imageBarriers.push_back(imageBarrier);
+                srcStages |= barrier.srcStages;
+                dstStages |= barrier.dstStages;
+            }
+            vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+                                 static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        }
+
+        // Created without memory; createTransients() binds it.
+        VkImage createImage(VkDevice& device, const Image& image, VkExtent2D extent) {
+            VkImageCreateInfo imageInfo = {};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent.width = extent.width;
+            imageInfo.extent.height = extent.height;
+            imageInfo.extent.depth = 1;
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = image.format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = image.usage;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VkImage created;
+            if (vkCreateImage(device, &imageInfo, nullptr, &created) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image " + image.name + "!");
+            }
+            return created;
+        }
+
+        VkImageView createView(VkDevice& device, VkImage image, VkFormat format) {
+            VkImageViewCreateInfo createInfo = {};
+            createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            createInfo.image = image;
+            createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            createInfo.format = format;
+            createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            createInfo.subresourceRange.baseMipLevel = 0;
+            createInfo.subresourceRange.levelCount = 1;
+            createInfo.subresourceRange.baseArrayLayer = 0;
+            createInfo.subresourceRange.layerCount = 1;
+
+            VkImageView view;
+            if (vkCreateImageView(device, &createInfo, nullptr, &view) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image view!");
+            }
+            return view;
+        }
+    };
+#endif
\ No newline at end of file
@@ -5,27 +5,36 @@
 
 #include <swapchain.cpp>
 
+#ifndef FRAME_BUFFER
+#define FRAME_BUFFER
 class FrameBuffer{
 
     std::vector<VkFramebuffer> frameBuffers;
 
 public:
     void init(VkDevice& device, SwapChain& swapChain, VkRenderPass& renderPass){
+        init(device, swapChain.getImageViews(), swapChain.getExtent(), renderPass);
+    }
+
+    void init(VkDevice& device, std::vector<VkImageView>& imageViews, VkExtent2D extent, VkRenderPass& renderPass){
+        std::vector<std::vector<VkImageView>> attachments;
+        for (auto& imageView : imageViews) {
+            attachments.push_back({imageView});
+        }
+        init(device, attachments, extent, renderPass);
+    }
+
+    // One framebuffer per entry of attachments, each over the views of that entry.
+    void init(VkDevice& device, const std::vector<std::vector<VkImageView>>& attachments, VkExtent2D extent, VkRenderPass& renderPass){
         std::cout << "Initializing frame buffer..." << std::endl;
-        int imageCount = swapChain.getSize();
+        int imageCount = attachments.size();
         frameBuffers.resize(imageCount);
         for (int i = 0; i < imageCount; i++) {
-            VkImageView attachments[] = {
-                    swapChain.getImageView(i)
-            };
-
-            VkExtent2D extent = swapChain.getExtent();
-
             VkFramebufferCreateInfo framebufferInfo = {};
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebufferInfo.renderPass = renderPass;
-            framebufferInfo.attachmentCount = 1;
-            framebufferInfo.pAttachments = attachments;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments[i].size());
+            framebufferInfo.pAttachments = attachments[i].data();
             framebufferInfo.width = extent.width;
             framebufferInfo.height = extent.height;
             framebufferInfo.layers = 1;
@@ -36,7 +45,7 @@ public:
         }
     }
 
-    VkImageView& getBuffer(int index){
+    VkFramebuffer& getBuffer(int index){
         return frameBuffers[index];
     }
 
@@ -45,4 +54,5 @@ public:
             vkDestroyFramebuffer(device, framebuffer, nullptr);
         }
     }
-};
\ No newline at end of file
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "deviceallocator.cpp"
+#include "commandutils.cpp"
+
+#ifndef OFFSCREEN_TARGET
+#define OFFSCREEN_TARGET
+    // Device-owned color images standing in for the swap chain when there is no window system.
+    class OffscreenTarget {
+        VkFormat imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+        VkExtent2D extent;
+        std::vector<VkImage> images;
+        std::vector<Allocation> imageAllocations;
+        std::vector<VkImageView> imageViews;
+
+    public:
+        void init(DeviceAllocator& allocator, VkDevice& device, uint32_t width, uint32_t height, uint32_t imageCount) {
+            std::cout << "Initializing offscreen target..." << std::endl;
+            extent = {width, height};
+
+            images.resize(imageCount);
+            imageAllocations.resize(imageCount);
+            imageViews.resize(imageCount);
+            for (uint32_t i = 0; i < imageCount; i++) {
+                createImage(allocator, images[i], imageAllocations[i]);
+                createImageView(device, images[i], imageViews[i]);
+            }
+        }
+
+        VkExtent2D& getExtent(){
+            return extent;
+        }
+
+        VkFormat& getImageFormat(){
+            return imageFormat;
+        }
+
+        size_t getSize(){
+            return images.size();
+        }
+
+        VkImageView& getImageView(int index){
+            return imageViews[index];
+        }
+
+        std::vector<VkImageView>& getImageViews(){
+            return imageViews;
+        }
+
+        std::vector<VkImage>& getImages(){
+            return images;
+        }
+
+        // Copies an image that was left in TRANSFER_SRC_OPTIMAL by the render graph into host memory and writes it as a
+        // binary PPM. Blocks on the queue, so only call this outside of the frame loop.
+        void readback(DeviceAllocator& allocator, VkDevice& device, VkCommandPool& commandPool, VkQueue& queue,
+                      int index, const std::string& filename) {
+            VkDeviceSize imageSize = extent.width * extent.height * 4;
+
+            VkBuffer stagingBuffer;
+            Allocation stagingAllocation = allocator.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                                  stagingBuffer);
+
+            VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+
+            VkImageMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = images[index];
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkBufferImageCopy region = {};
+            region.bufferOffset = 0;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = 0;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {extent.width, extent.height, 1};
+            vkCmdCopyImageToBuffer(commandBuffer, images[index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer, 1, &region);
+
+            endSingleTimeCommands(device, commandPool, queue, commandBuffer);
+
+            writePPM(filename, static_cast<const uint8_t*>(stagingAllocation.mapped));
+            allocator.destroyBuffer(stagingBuffer, stagingAllocation);
+        }
+
+        void cleanup(DeviceAllocator& allocator, VkDevice& device){
+            for (size_t i = 0; i < images.size(); i++) {
+                vkDestroyImageView(device, imageViews[i], nullptr);
+                allocator.destroyImage(images[i], imageAllocations[i]);
+            }
+        }
+
+    private:
+        void createImage(DeviceAllocator& allocator, VkImage& image, Allocation& allocation) {
+            VkImageCreateInfo imageInfo = {};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent.width = extent.width;
+            imageInfo.extent.height = extent.height;
+            imageInfo.extent.depth = 1;
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = imageFormat;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            allocation = allocator.createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image);
+        }
+
+        void createImageView(VkDevice& device, VkImage& image, VkImageView& imageView) {
+            VkImageViewCreateInfo createInfo = {};
+            createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            createInfo.image = image;
+            createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            createInfo.format = imageFormat;
+            createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            createInfo.subresourceRange.baseMipLevel = 0;
+            createInfo.subresourceRange.levelCount = 1;
+            createInfo.subresourceRange.baseArrayLayer = 0;
+            createInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device, &createInfo, nullptr, &imageView) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create offscreen image view!");
+            }
+        }
+
+        void writePPM(const std::string& filename, const uint8_t* pixels) {
+            std::ofstream file(filename, std::ios::binary);
+            if (!file.is_open()) {
+                throw std::runtime_error("failed to open output image!");
+            }
+
+            file << "P6\n" << extent.width << " " << extent.height << "\n255\n";
+            for (uint32_t i = 0; i < extent.width * extent.height; i++) {
+                file.write(reinterpret_cast<const char*>(pixels + i * 4), 3);
+            }
+        }
+    };
+#endif
@@ -0,0 +1,103 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef PRESENT_POLICY
+#define PRESENT_POLICY
+    // What presentation is tuned for. The policy decides present mode, swap chain image count and frames in flight
+    // together, since each only has the intended effect in combination with the others.
+    enum class PresentPolicy {
+        LowestLatency,  // Newest frame on screen as soon as possible: mailbox (or immediate), one frame in flight.
+        MaxThroughput,  // As many frames per second as possible: immediate (or mailbox), deep queue.
+        Vsync,          // One frame per refresh without tearing: FIFO, double buffered CPU/GPU overlap.
+        PowerSaving     // Least work per presented frame: FIFO with the fewest images and one frame in flight.
+    };
+
+    struct PresentConfig {
+        VkPresentModeKHR presentMode;
+        uint32_t imageCount;
+        uint32_t framesInFlight;
+    };
+
+    inline PresentPolicy parsePresentPolicy(const std::string& name) {
+        if (name == "latency") {
+            return PresentPolicy::LowestLatency;
+        } else if (name == "throughput") {
+            return PresentPolicy::MaxThroughput;
+        } else if (name == "vsync") {
+            return PresentPolicy::Vsync;
+        } else if (name == "power") {
+            return PresentPolicy::PowerSaving;
+        }
+        throw std::runtime_error("unknown present policy: " + name);
+    }
+
+    inline const char* presentPolicyName(PresentPolicy policy) {
+        switch (policy) {
+            case PresentPolicy::LowestLatency: return "latency";
+            case PresentPolicy::MaxThroughput: return "throughput";
+            case PresentPolicy::Vsync: return "vsync";
+            case PresentPolicy::PowerSaving: return "power";
+        }
+        return "unknown";
+    }
+
+    inline const char* presentModeName(VkPresentModeKHR presentMode) {
+        switch (presentMode) {
+            case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+            case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+            case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo_relaxed";
+            default: return "other";
+        }
+    }
+
+    // FIFO is the only mode every implementation must support, so it ends every preference list.
+    inline VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR>& preferred,
+                                              const std::vector<VkPresentModeKHR>& availablePresentModes) {
+        for (VkPresentModeKHR mode : preferred) {
+            for (VkPresentModeKHR available : availablePresentModes) {
+                if (mode == available) {
+                    return mode;
+                }
+            }
+        }
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    // maxImageCount of zero means there is no upper limit.
+    inline PresentConfig choosePresentConfig(PresentPolicy policy, const VkSurfaceCapabilitiesKHR& capabilities,
+                                             const std::vector<VkPresentModeKHR>& availablePresentModes) {
+        PresentConfig config = {};
+        uint32_t extraImages = 0;
+        switch (policy) {
+            case PresentPolicy::LowestLatency:
+                config.presentMode = choosePresentMode({VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR}, availablePresentModes);
+                // Mailbox needs a spare image to replace the queued one without blocking.
+                extraImages = config.presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 1 : 0;
+                config.framesInFlight = 1;
+                break;
+            case PresentPolicy::MaxThroughput:
+                config.presentMode = choosePresentMode({VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR}, availablePresentModes);
+                extraImages = 1;
+                config.framesInFlight = 3;
+                break;
+            case PresentPolicy::Vsync:
+                config.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+                extraImages = 1;
+                config.framesInFlight = 2;
+                break;
+            case PresentPolicy::PowerSaving:
+                config.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+                extraImages = 0;
+                config.framesInFlight = 1;
+                break;
+        }
+
+        config.imageCount = capabilities.minImageCount + extraImages;
+        if (capabilities.maxImageCount > 0 && config.imageCount > capabilities.maxImageCount) {
+            config.imageCount = capabilities.maxImageCount;
+        }
+        return config;
+    }
+#endif
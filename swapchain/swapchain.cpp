@@ -1,6 +1,7 @@
 #include <iostream>
 #include <algorithm>
 #include "QueueFamilyIndices.cpp"
+#include "presentpolicy.cpp"
 
 #ifndef SWAPCHAIN
 #define SWAPCHAIN
@@ -15,21 +16,27 @@
         VkSwapchainKHR swapchain;
         std::vector<VkImage> images;
         VkExtent2D extent;
+        VkImageUsageFlags imageUsage = 0;
         std::vector<VkImageView> imageViews;
-
+        PresentConfig presentConfig;
 
     public:
-        void init(VkPhysicalDevice& physicalDevice, VkDevice& device, VkSurfaceKHR& surface, uint32_t desired_width, uint32_t desired_height, QueueFamilyIndices queueFamilyIndices) {
+        // Passing the swap chain being replaced as oldSwapchain lets the presentation engine hand its resources over
+        // and retires it; it must still be destroyed by its owner once no frame uses it any more.
+        void init(VkPhysicalDevice& physicalDevice, VkDevice& device, VkSurfaceKHR& surface, uint32_t desired_width, uint32_t desired_height, QueueFamilyIndices queueFamilyIndices,
+                  PresentPolicy policy = PresentPolicy::Vsync, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE) {
             std::cout << "Initializing swap chain..." << std::endl;
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice, surface);
 
             chooseSwapSurfaceFormat(swapChainSupport.formats);
-            VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+            presentConfig = choosePresentConfig(policy, swapChainSupport.capabilities, swapChainSupport.presentModes);
             extent = chooseSwapExtent(swapChainSupport.capabilities, desired_width, desired_height);
+            std::cout << "Using " << presentModeName(presentConfig.presentMode) << " present mode with "
+                      << presentConfig.imageCount << " images for the " << presentPolicyName(policy) << " policy." << std::endl;
 
-            uint32_t imageCount = getImageCount(swapChainSupport);
+            uint32_t imageCount = presentConfig.imageCount;
 
-            createSwapChain(device, surface, queueFamilyIndices, swapChainSupport, presentMode, imageCount);
+            createSwapChain(device, surface, queueFamilyIndices, swapChainSupport, presentConfig.presentMode, imageCount, oldSwapchain);
 
             vkGetSwapchainImagesKHR(device, swapchain, &imageCount, nullptr);
             images.resize(imageCount);
@@ -54,10 +61,27 @@
             return imageViews[index];
         }
 
+        std::vector<VkImageView>& getImageViews(){
+            return imageViews;
+        }
+
+        std::vector<VkImage>& getImages(){
+            return images;
+        }
+
+        VkImageUsageFlags getImageUsage(){
+            return imageUsage;
+        }
+
         VkSwapchainKHR& getSwapChain(){
             return swapchain;
         }
 
+        // The image count is the minimum requested; getSize() is what the implementation actually created.
+        const PresentConfig& getPresentConfig(){
+            return presentConfig;
+        }
+
         static SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice& availableDevice, VkSurfaceKHR& surface) {
             SwapChainSupportDetails details;
 
@@ -80,10 +104,14 @@
             return details;
         }
 
-        uint32_t acquireNewImage(VkDevice& device, VkSemaphore signalSemaphore){
-            uint32_t imageIndex;
-            vkAcquireNextImageKHR(device, swapchain, std::numeric_limits<uint64_t>::max(), signalSemaphore, VK_NULL_HANDLE, &imageIndex);
-            return imageIndex;
+        // Returns VK_ERROR_OUT_OF_DATE_KHR without signaling the semaphore when the swap chain must be recreated
+        // first. VK_SUBOPTIMAL_KHR still acquires an image.
+        VkResult acquireNewImage(VkDevice& device, VkSemaphore signalSemaphore, uint32_t& imageIndex){
+            VkResult result = vkAcquireNextImageKHR(device, swapchain, std::numeric_limits<uint64_t>::max(), signalSemaphore, VK_NULL_HANDLE, &imageIndex);
+            if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR) {
+                throw std::runtime_error("failed to acquire swap chain image!");
+            }
+            return result;
         }
 
         void cleanup(VkDevice& device){
@@ -98,7 +126,8 @@
         void createSwapChain(VkDevice& device, VkSurfaceKHR& surface, QueueFamilyIndices queueFamilyIndices,
                              SwapChainSupportDetails &swapChainSupport,
                              VkPresentModeKHR &presentMode,
-                             uint32_t imageCount)  {
+                             uint32_t imageCount,
+                             VkSwapchainKHR oldSwapchain)  {
             VkSwapchainCreateInfoKHR createInfo = {};
             createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
             createInfo.surface = surface;
@@ -107,7 +136,10 @@
             createInfo.imageColorSpace = surfaceFormat.colorSpace;
             createInfo.imageExtent = extent;
             createInfo.imageArrayLayers = 1;
-            createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            // Transfer destination where supported, so the render graph can blit into the images.
+            imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                         (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+            createInfo.imageUsage = imageUsage;
 
             if (queueFamilyIndices.graphicsFamily != queueFamilyIndices.presentFamily) {
                 uint32_t indices[] = {queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.presentFamily.value()};
@@ -126,21 +158,13 @@
             createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
             createInfo.presentMode = presentMode;
             createInfo.clipped = VK_TRUE;
-            createInfo.oldSwapchain = VK_NULL_HANDLE;
+            createInfo.oldSwapchain = oldSwapchain;
 
             if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create swap chain!");
             }
         }
 
-        uint32_t getImageCount(const SwapChainSupportDetails &swapChainSupport) const {
-            uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-            if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-                imageCount = swapChainSupport.capabilities.maxImageCount;
-            }
-            return imageCount;
-        }
-
         void chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
             for (const auto& availableFormat : availableFormats) {
                 if (availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
@@ -151,24 +175,6 @@
             surfaceFormat = availableFormats[0];
         }
 
-        static VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-            VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
-
-            for (const auto& availablePresentMode : availablePresentModes) {
-                if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                    bestMode = availablePresentMode;
-                } else if (availablePresentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR) {
-                    bestMode = availablePresentMode;
-                } else if (availablePresentMode == VK_PRESENT_MODE_FIFO_KHR) {
-                    bestMode = availablePresentMode;
-                } else if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-                    bestMode = availablePresentMode;
-                }
-            }
-
-            return bestMode;
-        }
-
         static VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, uint32_t width, uint32_t height) {
             if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
                 return capabilities.currentExtent;
@@ -0,0 +1,43 @@
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "threadpool.cpp"
+#include "fileutils.cpp"
+
+#ifndef ASSET_LOADER
+#define ASSET_LOADER
+    using MappedAsset = std::shared_ptr<const MappedFile>;
+
+    // Maps assets on worker threads and faults their pages in ahead of use, so the thread that later creates shader
+    // modules or records uploads from them never blocks on disk I/O. Nothing is copied: the returned MappedFile is
+    // the file cache's own pages, which stay valid for as long as a reference to the asset is held.
+    class AssetLoader {
+        ThreadPool workers;
+
+    public:
+        void init(size_t threadCount) {
+            std::cout << "Initializing asset loader (" << threadCount << " threads)..." << std::endl;
+            workers.init(threadCount);
+        }
+
+        // Starts mapping and reading path in the background. Errors, e.g. a missing file, are rethrown by get().
+        std::shared_future<MappedAsset> prefetch(const std::string& path) {
+            return workers.submit([path] {
+                auto asset = std::make_shared<const MappedFile>(path);
+                asset->adviseWillNeed();
+                asset->touchPages();
+                return MappedAsset(asset);
+            }).share();
+        }
+
+        // Maps path on the calling thread; pages are read in lazily on first access.
+        static MappedAsset load(const std::string& path) {
+            return std::make_shared<const MappedFile>(path);
+        }
+
+        void cleanup() {
+            workers.cleanup();
+        }
+    };
+#endif
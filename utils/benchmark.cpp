@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef BENCHMARK
+#define BENCHMARK
+    class Stopwatch {
+        std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+
+    public:
+        // Milliseconds since construction or the previous lap.
+        double lap() {
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double, std::milli>(now - last).count();
+            last = now;
+            return elapsed;
+        }
+    };
+
+    struct SampleSummary {
+        size_t count = 0;
+        double min = 0.0;
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    SampleSummary summarize(std::vector<double> samples) {
+        SampleSummary summary;
+        if (samples.empty()) {
+            return summary;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p) {
+            // Nearest-rank percentile.
+            size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+            return samples[std::max<size_t>(rank, 1) - 1];
+        };
+
+        double sum = 0.0;
+        for (double sample : samples) {
+            sum += sample;
+        }
+
+        summary.count = samples.size();
+        summary.min = samples.front();
+        summary.mean = sum / samples.size();
+        summary.p50 = percentile(50.0);
+        summary.p95 = percentile(95.0);
+        summary.p99 = percentile(99.0);
+        summary.max = samples.back();
+        return summary;
+    }
+
+    // Collects per-frame samples grouped by kind (e.g. "cpu_ms") and scalar run metrics, and reports them as JSON so
+    // runs can be diffed across commits.
+    class FrameBenchmark {
+        bool enabled = false;
+        std::map<std::string, std::string> info;
+        std::map<std::string, std::map<std::string, std::vector<double>>> groups;
+        std::map<std::string, double> metrics;
+
+    public:
+        void enable() {
+            enabled = true;
+        }
+
+        bool isEnabled() {
+            return enabled;
+        }
+
+        void setInfo(const std::string& key, const std::string& value) {
+            info[key] = value;
+        }
+
+        void setMetric(const std::string& key, double value) {
+            metrics[key] = value;
+        }
+
+        void record(const std::string& group, const std::string& name, double value) {
+            if (enabled) {
+                groups[group][name].push_back(value);
+            }
+        }
+
+        void record(const std::string& name, double milliseconds) {
+            record("cpu_ms", name, milliseconds);
+        }
+
+        double sum(const std::string& group, const std::string& name) {
+            double total = 0.0;
+            auto groupIt = groups.find(group);
+            if (groupIt == groups.end() || groupIt->second.count(name) == 0) {
+                return total;
+            }
+            for (double sample : groupIt->second.at(name)) {
+                total += sample;
+            }
+            return total;
+        }
+
+        void writeJson(std::ostream& out) {
+            out << "{\n";
+            out << "  \"info\": {";
+            const char* separator = "\n";
+            for (auto& entry : info) {
+                out << separator << "    \"" << escape(entry.first) << "\": \"" << escape(entry.second) << "\"";
+                separator = ",\n";
+            }
+            out << "\n  }";
+
+            for (auto& group : groups) {
+                out << ",\n  \"" << escape(group.first) << "\": {";
+                separator = "\n";
+                for (auto& series : group.second) {
+                    SampleSummary summary = summarize(series.second);
+                    out << separator << "    \"" << escape(series.first) << "\": {"
+                        << "\"count\": " << summary.count
+                        << ", \"min\": " << number(summary.min)
+                        << ", \"mean\": " << number(summary.mean)
+                        << ", \"p50\": " << number(summary.p50)
+                        << ", \"p95\": " << number(summary.p95)
+                        << ", \"p99\": " << number(summary.p99)
+                        << ", \"max\": " << number(summary.max) << "}";
+                    separator = ",\n";
+                }
+                out << "\n  }";
+            }
+
+            out << ",\n  \"metrics\": {";
+            separator = "\n";
+            for (auto& metric : metrics) {
+                out << separator << "    \"" << escape(metric.first) << "\": " << number(metric.second);
+                separator = ",\n";
+            }
+            out << "\n  }\n}\n";
+        }
+
+        // Points std::cout at stderr so the log cannot interleave with JSON written to stdout by write(). Call before
+        // anything else is logged.
+        static void reserveStdout() {
+            resultBuffer() = std::cout.rdbuf(std::cerr.rdbuf());
+        }
+
+        // Writes the JSON to path, or to stdout if path is empty.
+        void write(const std::string& path) {
+            if (path.empty()) {
+                std::ostream out(resultBuffer() != nullptr ? resultBuffer() : std::cout.rdbuf());
+                writeJson(out);
+                out.flush();
+                return;
+            }
+
+            std::ofstream file(path);
+            if (!file.is_open()) {
+                throw std::runtime_error("failed to open benchmark output!");
+            }
+            writeJson(file);
+            std::cout << "Wrote benchmark results to " << path << std::endl;
+        }
+
+    private:
+        static std::streambuf*& resultBuffer() {
+            static std::streambuf* buffer = nullptr;
+            return buffer;
+        }
+
+        // Whole numbers (counts, bytes) are written as integers and everything else with enough digits to read back
+        // the exact double, so results of different runs compare exactly.
+        static std::string number(double value) {
+            std::ostringstream text;
+            if (std::isfinite(value) && value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+                text << static_cast<int64_t>(value);
+            } else {
+                text << std::setprecision(std::numeric_limits<double>::max_digits10) << value;
+            }
+            return text.str();
+        }
+
+        static std::string escape(const std::string& value) {
+            std::string escaped;
+            for (char c : value) {
+                if (c == '"' || c == '\\') {
+                    escaped += '\\';
+                }
+                escaped += c;
+            }
+            return escaped;
+        }
+    };
+#endif
@@ -0,0 +1,45 @@
+#include <deque>
+#include <functional>
+
+#ifndef DELETION_QUEUE
+#define DELETION_QUEUE
+    // Destroys objects that may still be referenced by submitted frames. Each entry is tagged with the number of the
+    // last frame that can use it and runs once that frame is known to have completed, so replacing objects never
+    // requires draining the GPU with vkDeviceWaitIdle.
+    class DeletionQueue {
+        struct Entry {
+            uint64_t lastFrame;
+            std::function<void()> destroy;
+        };
+
+        std::deque<Entry> entries;
+
+    public:
+        // Entries must be pushed in non-decreasing frame order.
+        void push(uint64_t lastFrame, std::function<void()> destroy) {
+            entries.push_back({lastFrame, std::move(destroy)});
+        }
+
+        // Runs every entry whose last frame is at or before completedFrame.
+        void collect(uint64_t completedFrame) {
+            while (!entries.empty() && entries.front().lastFrame <= completedFrame) {
+                std::function<void()> destroy = std::move(entries.front().destroy);
+                entries.pop_front();
+                destroy();
+            }
+        }
+
+        size_t getSize() {
+            return entries.size();
+        }
+
+        // Only valid once the device is idle.
+        void flush() {
+            while (!entries.empty()) {
+                std::function<void()> destroy = std::move(entries.front().destroy);
+                entries.pop_front();
+                destroy();
+            }
+        }
+    };
+#endif
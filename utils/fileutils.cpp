@@ -1,21 +1,196 @@
-#include <fstream>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #ifndef FILE_UTILS
 #define FILE_UTILS
-    std::vector<char> readFile(const std::string& filename) {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    // A read-only view of size elements, e.g. SPIR-V words or vertices inside a MappedFile.
+    template<typename T>
+    struct ConstSpan {
+        const T* data = nullptr;
+        size_t size = 0;
+
+        const T* begin() const {
+            return data;
+        }
+
+        const T* end() const {
+            return data + size;
+        }
+
+        const T& operator[](size_t index) const {
+            return data[index];
+        }
 
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file!");
+        size_t sizeBytes() const {
+            return size * sizeof(T);
         }
+    };
 
-        size_t fileSize = (size_t) file.tellg();
-        std::vector<char> buffer(fileSize);
+    // A file mapped read-only into memory. Pages are read in by the OS on first access and shared with its file
+    // cache, so the contents can be handed straight to Vulkan (shader modules, staging uploads) without reading into
+    // an intermediate buffer. The mapping is page aligned, so spans of any element type are suitably aligned.
+    class MappedFile {
+        const char* bytes = nullptr;
+        size_t fileSize = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#endif
 
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-        file.close();
+    public:
+        MappedFile() = default;
 
-        return buffer;
-    }
-#endif
\ No newline at end of file
+        explicit MappedFile(const std::string& path) {
+            open(path);
+        }
+
+        MappedFile(MappedFile&& other) noexcept {
+            *this = std::move(other);
+        }
+
+        MappedFile& operator=(MappedFile&& other) noexcept {
+            if (this != &other) {
+                close();
+                std::swap(bytes, other.bytes);
+                std::swap(fileSize, other.fileSize);
+#ifdef _WIN32
+                std::swap(file, other.file);
+                std::swap(mapping, other.mapping);
+#endif
+            }
+            return *this;
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+            close();
+        }
+
+        const char* data() const {
+            return bytes;
+        }
+
+        size_t size() const {
+            return fileSize;
+        }
+
+        // The whole file as elements of T; throws if the size is not a multiple of sizeof(T).
+        template<typename T>
+        ConstSpan<T> span() const {
+            if (fileSize % sizeof(T) != 0) {
+                throw std::runtime_error("mapped file size is not a multiple of the element size!");
+            }
+            return {reinterpret_cast<const T*>(bytes), fileSize / sizeof(T)};
+        }
+
+        // Asks the OS to start reading the whole file in, without blocking. Only a hint; failures are ignored.
+        void adviseWillNeed() const {
+            if (fileSize == 0) {
+                return;
+            }
+#ifdef _WIN32
+            WIN32_MEMORY_RANGE_ENTRY range = {const_cast<char*>(bytes), fileSize};
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+            madvise(const_cast<char*>(bytes), fileSize, MADV_WILLNEED);
+#endif
+        }
+
+        // Faults every page in on the calling thread, so later reads do not block on I/O.
+        void touchPages() const {
+            const size_t pageSize = 4096;
+            volatile char sink = 0;
+            for (size_t offset = 0; offset < fileSize; offset += pageSize) {
+                sink = sink + bytes[offset];
+            }
+        }
+
+    private:
+        // Empty files are not mapped; data() is then nullptr.
+        void open(const std::string& path) {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            LARGE_INTEGER size;
+            if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+                close();
+                throw std::runtime_error("failed to open file " + path + "!");
+            }
+            fileSize = static_cast<size_t>(size.QuadPart);
+            if (fileSize == 0) {
+                return;
+            }
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            bytes = mapping != nullptr ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+            if (bytes == nullptr) {
+                close();
+                throw std::runtime_error("failed to map file " + path + "!");
+            }
+#else
+            int descriptor = ::open(path.c_str(), O_RDONLY);
+            struct stat status;
+            if (descriptor < 0 || fstat(descriptor, &status) != 0) {
+                if (descriptor >= 0) {
+                    ::close(descriptor);
+                }
+                throw std::runtime_error("failed to open file " + path + "!");
+            }
+            fileSize = static_cast<size_t>(status.st_size);
+            if (fileSize == 0) {
+                ::close(descriptor);
+                return;
+            }
+            // The mapping keeps the file referenced, so the descriptor is not needed past this point.
+            void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            ::close(descriptor);
+            if (mapped == MAP_FAILED) {
+                fileSize = 0;
+                throw std::runtime_error("failed to map file " + path + "!");
+            }
+            bytes = static_cast<const char*>(mapped);
+#endif
+        }
+
+        void close() {
+#ifdef _WIN32
+            if (bytes != nullptr) {
+                UnmapViewOfFile(bytes);
+            }
+            if (mapping != nullptr) {
+                CloseHandle(mapping);
+            }
+            if (file != INVALID_HANDLE_VALUE) {
+                CloseHandle(file);
+            }
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (bytes != nullptr) {
+                munmap(const_cast<char*>(bytes), fileSize);
+            }
+#endif
+            bytes = nullptr;
+            fileSize = 0;
+        }
+    };
+#endif
@@ -0,0 +1,49 @@
+#include <chrono>
+#include <thread>
+
+#ifndef FRAME_PACER
+#define FRAME_PACER
+    // Caps the frame rate by holding the CPU at the end of each frame until the next frame's start time. Start times
+    // advance by a fixed period, so an occasional slow frame is absorbed by the following ones; when the renderer falls
+    // more than a period behind, the schedule restarts from now instead of rushing to catch up.
+    class FramePacer {
+        using Clock = std::chrono::steady_clock;
+
+        // sleep_for routinely overshoots by up to a scheduler tick, so the last stretch is spent yielding.
+        const std::chrono::microseconds spinThreshold = std::chrono::microseconds(1000);
+
+        Clock::duration period = Clock::duration::zero();
+        Clock::time_point nextFrame;
+
+    public:
+        void init(uint32_t targetFps) {
+            period = targetFps > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps))
+                                   : Clock::duration::zero();
+            nextFrame = Clock::now() + period;
+        }
+
+        bool isEnabled() {
+            return period > Clock::duration::zero();
+        }
+
+        void wait() {
+            if (!isEnabled()) {
+                return;
+            }
+
+            Clock::time_point now = Clock::now();
+            if (now > nextFrame + period) {
+                nextFrame = now + period;
+                return;
+            }
+
+            if (nextFrame - now > spinThreshold) {
+                std::this_thread::sleep_for(nextFrame - now - spinThreshold);
+            }
+            while (Clock::now() < nextFrame) {
+                std::this_thread::yield();
+            }
+            nextFrame += period;
+        }
+    };
+#endif
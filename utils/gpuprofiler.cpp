@@ -0,0 +1,251 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef GPU_PROFILER
+#define GPU_PROFILER
+    struct GpuScopeResult {
+        std::string name;
+        double milliseconds = 0.0;
+        bool hasStatistics = false;
+        uint64_t inputVertices = 0;
+        uint64_t vertexInvocations = 0;
+        uint64_t clippingPrimitives = 0;
+        uint64_t fragmentInvocations = 0;
+        uint64_t computeInvocations = 0;
+    };
+
+    // Named GPU scopes backed by timestamp and pipeline statistics query pools. Queries are partitioned into slots
+    // (one per command buffer that may be in flight); a slot is only read back by collect() once the fence guarding
+    // its last submission has signaled, so reading results never stalls the GPU.
+    class GpuProfiler {
+        const VkQueryPipelineStatisticFlags statisticFlags =
+                VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+        static const uint32_t statisticCount = 5;
+
+        struct RecordedScope {
+            uint32_t id;
+            bool hasStatistics;
+        };
+
+        struct Slot {
+            std::vector<RecordedScope> scopes;
+            std::vector<size_t> openScopes;
+            bool statisticsActive = false;
+        };
+
+        VkQueryPool timestampPool = VK_NULL_HANDLE;
+        VkQueryPool statisticsPool = VK_NULL_HANDLE;
+        double timestampPeriod = 1.0;
+        uint64_t timestampMask = ~0ull;
+        uint32_t maxScopes = 0;
+        bool statisticsInherited = false;
+
+        std::vector<std::string> scopeNames;
+        std::vector<Slot> slots;
+        std::vector<GpuScopeResult> results;
+
+    public:
+        // statisticsInheritable is whether the inheritedQueries feature is enabled, which a statistics query needs to
+        // stay active while secondary command buffers execute.
+        void init(VkPhysicalDevice& physicalDevice, VkDevice& device, uint32_t queueFamilyIndex, uint32_t slotCount,
+                  bool statisticsEnabled, bool statisticsInheritable, uint32_t maxScopesPerSlot = 32) {
+            std::cout << "Initializing GPU profiler..." << std::endl;
+            maxScopes = maxScopesPerSlot;
+            slots.resize(slotCount);
+
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+            timestampPeriod = properties.limits.timestampPeriod;
+
+            uint32_t queueFamilyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+            uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+            if (validBits > 0) {
+                timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+                timestampPool = createQueryPool(device, VK_QUERY_TYPE_TIMESTAMP, slotCount * maxScopes * 2, 0);
+            } else {
+                std::cout << "Timestamps are not supported on the graphics queue, GPU times will be unavailable." << std::endl;
+            }
+
+            if (statisticsEnabled) {
+                statisticsPool = createQueryPool(device, VK_QUERY_TYPE_PIPELINE_STATISTICS, slotCount * maxScopes, statisticFlags);
+                statisticsInherited = statisticsInheritable;
+            }
+        }
+
+        bool isEnabled() {
+            return timestampPool != VK_NULL_HANDLE || statisticsPool != VK_NULL_HANDLE;
+        }
+
+        // Whether a scope collecting statistics may enclose vkCmdExecuteCommands.
+        bool canInheritStatistics() {
+            return statisticsInherited;
+        }
+
+        // Statistics a secondary command buffer must declare in its inheritance info to be counted by an enclosing scope.
+        VkQueryPipelineStatisticFlags getInheritedStatistics() {
+            return statisticsInherited ? statisticFlags : 0;
+        }
+
+        // Must be recorded outside of a render pass before any scope of the slot.
+        void resetSlot(VkCommandBuffer commandBuffer, uint32_t slot) {
+            slots[slot] = Slot();
+            if (timestampPool != VK_NULL_HANDLE) {
+                vkCmdResetQueryPool(commandBuffer, timestampPool, slot * maxScopes * 2, maxScopes * 2);
+            }
+            if (statisticsPool != VK_NULL_HANDLE) {
+                vkCmdResetQueryPool(commandBuffer, statisticsPool, slot * maxScopes, maxScopes);
+            }
+        }
+
+        // Pipeline statistics cannot nest, so only the outermost scope collects them; pass statistics = false for a scope
+        // that must not, e.g. one executing secondaries without canInheritStatistics(). A scope that begins outside a
+        // render pass must also end outside of it.
+        void beginScope(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name, bool statistics = true) {
+            if (!isEnabled()) {
+                return;
+            }
+
+            Slot& state = slots[slot];
+            if (state.scopes.size() >= maxScopes) {
+                throw std::runtime_error("too many GPU profiler scopes!");
+            }
+
+            RecordedScope scope = {getScopeId(name), false};
+            uint32_t index = static_cast<uint32_t>(state.scopes.size());
+
+            if (timestampPool != VK_NULL_HANDLE) {
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, timestampQuery(slot, index));
+            }
+            if (statisticsPool != VK_NULL_HANDLE && statistics && !state.statisticsActive) {
+                vkCmdBeginQuery(commandBuffer, statisticsPool, statisticsQuery(slot, index), 0);
+                state.statisticsActive = true;
+                scope.hasStatistics = true;
+            }
+
+            state.scopes.push_back(scope);
+            state.openScopes.push_back(index);
+        }
+
+        void endScope(VkCommandBuffer commandBuffer, uint32_t slot) {
+            if (!isEnabled()) {
+                return;
+            }
+
+            Slot& state = slots[slot];
+            if (state.openScopes.empty()) {
+                throw std::runtime_error("GPU profiler scope ended without being started!");
+            }
+
+            uint32_t index = static_cast<uint32_t>(state.openScopes.back());
+            state.openScopes.pop_back();
+
+            if (timestampPool != VK_NULL_HANDLE) {
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, timestampQuery(slot, index) + 1);
+            }
+            if (state.scopes[index].hasStatistics) {
+                vkCmdEndQuery(commandBuffer, statisticsPool, statisticsQuery(slot, index));
+                state.statisticsActive = false;
+            }
+        }
+
+        // Reads the results of the slot's last submission without waiting. Returns false if they are not available.
+        bool collect(VkDevice& device, uint32_t slot) {
+            if (!isEnabled()) {
+                return false;
+            }
+
+            Slot& state = slots[slot];
+            std::vector<GpuScopeResult> collected;
+            for (uint32_t index = 0; index < state.scopes.size(); index++) {
+                GpuScopeResult result;
+                result.name = scopeNames[state.scopes[index].id];
+
+                if (timestampPool != VK_NULL_HANDLE) {
+                    uint64_t timestamps[2];
+                    if (vkGetQueryPoolResults(device, timestampPool, timestampQuery(slot, index), 2, sizeof(timestamps),
+                                              timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+                        return false;
+                    }
+                    uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+                    result.milliseconds = ticks * timestampPeriod / 1000000.0;
+                }
+
+                if (state.scopes[index].hasStatistics) {
+                    uint64_t statistics[statisticCount];
+                    if (vkGetQueryPoolResults(device, statisticsPool, statisticsQuery(slot, index), 1, sizeof(statistics),
+                                              statistics, sizeof(statistics), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+                        return false;
+                    }
+                    // Results are written in the bit order of statisticFlags.
+                    result.hasStatistics = true;
+                    result.inputVertices = statistics[0];
+                    result.vertexInvocations = statistics[1];
+                    result.clippingPrimitives = statistics[2];
+                    result.fragmentInvocations = statistics[3];
+                    result.computeInvocations = statistics[4];
+                }
+
+                collected.push_back(result);
+            }
+
+            results = collected;
+            return true;
+        }
+
+        // Results of the most recent successful collect().
+        const std::vector<GpuScopeResult>& getResults() {
+            return results;
+        }
+
+        void cleanup(VkDevice& device) {
+            if (timestampPool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(device, timestampPool, nullptr);
+            }
+            if (statisticsPool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(device, statisticsPool, nullptr);
+            }
+        }
+
+    private:
+        uint32_t getScopeId(const std::string& name) {
+            for (uint32_t id = 0; id < scopeNames.size(); id++) {
+                if (scopeNames[id] == name) {
+                    return id;
+                }
+            }
+            scopeNames.push_back(name);
+            return static_cast<uint32_t>(scopeNames.size() - 1);
+        }
+
+        uint32_t timestampQuery(uint32_t slot, uint32_t index) {
+            return (slot * maxScopes + index) * 2;
+        }
+
+        uint32_t statisticsQuery(uint32_t slot, uint32_t index) {
+            return slot * maxScopes + index;
+        }
+
+        static VkQueryPool createQueryPool(VkDevice& device, VkQueryType type, uint32_t queryCount, VkQueryPipelineStatisticFlags statistics) {
+            VkQueryPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolInfo.queryType = type;
+            poolInfo.queryCount = queryCount;
+            poolInfo.pipelineStatistics = statistics;
+
+            VkQueryPool queryPool;
+            if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create query pool!");
+            }
+            return queryPool;
+        }
+    };
+#endif
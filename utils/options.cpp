@@ -0,0 +1,115 @@
+#include <string>
+#include <stdexcept>
+
+#ifndef APP_OPTIONS
+#define APP_OPTIONS
+    struct AppOptions {
+        bool headless = false;
+        uint32_t frameCount = 1;
+        std::string outputImage;
+        uint32_t benchmarkFrames = 0;
+        std::string benchmarkOutput;
+        bool gpuProfile = false;
+        std::string pipelineCachePath = "pipeline_cache.bin";
+        size_t compileThreads = 0;
+        uint32_t uploadStressKilobytes = 0;
+        uint32_t drawCount = 1;
+        uint32_t instanceCount = 1;
+        size_t recordThreads = 0;
+        std::string presentPolicy = "vsync";
+        uint32_t targetFps = 0;
+        uint32_t framesInFlight = 0;
+        bool timelineSync = false;
+        bool gpuCull = false;
+        bool cpuCull = false;
+        bool hotReload = false;
+        bool translucent = false;
+        bool bindless = false;
+        float renderScale = 1.0f;
+        uint32_t cullBenchObjects = 0;
+    };
+
+    uint32_t parseCount(const std::string& option, const std::string& value) {
+        try {
+            long count = std::stol(value);
+            if (count > 0) {
+                return static_cast<uint32_t>(count);
+            }
+        } catch (const std::exception&) {}
+        throw std::runtime_error("invalid value for " + option + ": " + value);
+    }
+
+    float parseScale(const std::string& option, const std::string& value) {
+        try {
+            float scale = std::stof(value);
+            if (scale > 0.0f && scale <= 4.0f) {
+                return scale;
+            }
+        } catch (const std::exception&) {}
+        throw std::runtime_error("invalid value for " + option + ": " + value);
+    }
+
+    AppOptions parseOptions(int argc, char* argv[]) {
+        AppOptions options;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "--headless") {
+                options.headless = true;
+            } else if (arg == "--frames" && hasValue) {
+                options.frameCount = parseCount(arg, argv[++i]);
+            } else if (arg == "--output" && hasValue) {
+                options.outputImage = argv[++i];
+            } else if (arg == "--benchmark" && hasValue) {
+                options.benchmarkFrames = parseCount(arg, argv[++i]);
+            } else if (arg == "--benchmark-output" && hasValue) {
+                options.benchmarkOutput = argv[++i];
+            } else if (arg == "--gpu-profile") {
+                options.gpuProfile = true;
+            } else if (arg == "--pipeline-cache" && hasValue) {
+                options.pipelineCachePath = argv[++i];
+            } else if (arg == "--no-pipeline-cache") {
+                options.pipelineCachePath.clear();
+            } else if (arg == "--compile-threads" && hasValue) {
+                options.compileThreads = parseCount(arg, argv[++i]);
+            } else if (arg == "--upload-stress" && hasValue) {
+                options.uploadStressKilobytes = parseCount(arg, argv[++i]);
+            } else if (arg == "--draws" && hasValue) {
+                options.drawCount = parseCount(arg, argv[++i]);
+            } else if (arg == "--instances" && hasValue) {
+                options.instanceCount = parseCount(arg, argv[++i]);
+            } else if (arg == "--record-threads" && hasValue) {
+                options.recordThreads = parseCount(arg, argv[++i]);
+            } else if (arg == "--present-policy" && hasValue) {
+                options.presentPolicy = argv[++i];
+            } else if (arg == "--target-fps" && hasValue) {
+                options.targetFps = parseCount(arg, argv[++i]);
+            } else if (arg == "--frames-in-flight" && hasValue) {
+                options.framesInFlight = parseCount(arg, argv[++i]);
+            } else if (arg == "--timeline-sync") {
+                options.timelineSync = true;
+            } else if (arg == "--gpu-cull") {
+                options.gpuCull = true;
+            } else if (arg == "--cpu-cull") {
+                options.cpuCull = true;
+            } else if (arg == "--hot-reload") {
+                options.hotReload = true;
+            } else if (arg == "--translucent") {
+                options.translucent = true;
+            } else if (arg == "--bindless") {
+                options.bindless = true;
+            } else if (arg == "--cull-bench" && hasValue) {
+                options.cullBenchObjects = parseCount(arg, argv[++i]);
+            } else if (arg == "--render-scale" && hasValue) {
+                options.renderScale = parseScale(arg, argv[++i]);
+            } else {
+                throw std::runtime_error("unknown or incomplete option: " + arg);
+            }
+        }
+        if (options.gpuCull && options.cpuCull) {
+            throw std::runtime_error("--gpu-cull and --cpu-cull cannot be combined");
+        }
+        return options;
+    }
+#endif
@@ -9,6 +9,21 @@ void createSemaphore(VkDevice& device, VkSemaphore& semaphore){
     }
 }
 
+// A timeline semaphore starting at 0; needs the Vulkan 1.2 timelineSemaphore feature.
+void createTimelineSemaphore(VkDevice& device, VkSemaphore& semaphore){
+    VkSemaphoreTypeCreateInfo typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+}
+
 void createSemaphores(VkDevice& device, std::vector<VkSemaphore>& semaphores){
     for (size_t i = 0; i < semaphores.size(); i++) {
         createSemaphore(device, semaphores[i]);
@@ -0,0 +1,82 @@
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#ifndef THREAD_POOL
+#define THREAD_POOL
+    class ThreadPool {
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+
+    public:
+        ~ThreadPool() {
+            cleanup();
+        }
+
+        void init(size_t threadCount) {
+            stopping = false;
+            for (size_t i = 0; i < threadCount; i++) {
+                workers.emplace_back([this] { work(); });
+            }
+        }
+
+        size_t getSize() {
+            return workers.size();
+        }
+
+        template<typename Function>
+        auto submit(Function function) -> std::future<decltype(function())> {
+            using Result = decltype(function());
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+            std::future<Result> result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.emplace([task] { (*task)(); });
+            }
+            condition.notify_one();
+            return result;
+        }
+
+        // Finishes all queued jobs, then joins the workers.
+        void cleanup() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            workers.clear();
+        }
+
+        static size_t defaultThreadCount() {
+            size_t hardwareThreads = std::thread::hardware_concurrency();
+            return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+    private:
+        void work() {
+            while (true) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [this] { return stopping || !jobs.empty(); });
+                    if (jobs.empty()) {
+                        return;
+                    }
+                    job = std::move(jobs.front());
+                    jobs.pop();
+                }
+                job();
+            }
+        }
+    };
+#endif